@@ -0,0 +1,249 @@
+#include "bench.h"
+
+#include <getopt.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+BenchState::BenchState(uint64_t iterations, int64_t arg)
+    : iterations_(iterations), arg_(arg), bytes_(0), items_(0),
+      running_(true), skipped_(false), start_(BenchClock::now()), elapsed_(0) {}
+
+void BenchState::ResetTimer() {
+    elapsed_ = BenchClock::duration(0);
+    start_ = BenchClock::now();
+}
+
+void BenchState::PauseTiming() {
+    if(running_) {
+        elapsed_ += BenchClock::now() - start_;
+        running_ = false;
+    }
+}
+
+void BenchState::ResumeTiming() {
+    if(!running_) {
+        start_ = BenchClock::now();
+        running_ = true;
+    }
+}
+
+void BenchState::SkipWithError(const string& msg) {
+    skipped_ = true;
+    error_ = msg;
+}
+
+uint64_t BenchState::ElapsedNs() const {
+    BenchClock::duration d = elapsed_;
+    if(running_) {
+        d += BenchClock::now() - start_;
+    }
+    return chrono::duration_cast<chrono::nanoseconds>(d).count();
+}
+
+vector<BenchInfo>& BenchRegistry() {
+    static vector<BenchInfo> registry;
+    return registry;
+}
+
+BenchRegistrar::BenchRegistrar(const char* name, BenchFunc fn, int64_t arg) {
+    BenchRegistry().push_back({name, fn, arg});
+}
+
+struct BenchResult {
+    string name;
+    uint64_t iterations;
+    double nsPerOp;         // 各轮中位数
+    double minNsPerOp;
+    double maxNsPerOp;
+    double bytesPerSec;
+    double itemsPerSec;
+    bool skipped;
+    string error;
+};
+
+static BenchResult RunOne(const BenchInfo& info, double minSec, int reps) {
+    BenchResult res = {info.name, 0, 0, 0, 0, 0, 0, false, ""};
+    const uint64_t MAX_ITERS = 1000000000ULL;
+    const double minNs = minSec * 1e9;
+
+    /* 标定：迭代次数逐步放大，直到单轮耗时达到minSec */
+    uint64_t iters = 1;
+    while(true) {
+        BenchState state(iters, info.arg);
+        info.fn(state);
+        if(state.Skipped()) {
+            res.skipped = true;
+            res.error = state.Error();
+            return res;
+        }
+        double ns = static_cast<double>(state.ElapsedNs());
+        if(ns >= minNs || iters >= MAX_ITERS) {
+            break;
+        }
+        double scale = ns > 0 ? minNs * 1.2 / ns : 10;
+        scale = max(1.5, min(scale, 10.0));
+        iters = min(MAX_ITERS, static_cast<uint64_t>(iters * scale) + 1);
+    }
+
+    vector<double> perOp;
+    vector<double> bytesPerSec;
+    vector<double> itemsPerSec;
+    for(int r = 0; r < reps; r++) {
+        BenchState state(iters, info.arg);
+        info.fn(state);
+        double ns = max<double>(1, state.ElapsedNs());
+        perOp.push_back(ns / iters);
+        bytesPerSec.push_back(state.BytesProcessed() * 1e9 / ns);
+        itemsPerSec.push_back(state.ItemsProcessed() * 1e9 / ns);
+    }
+    sort(perOp.begin(), perOp.end());
+    sort(bytesPerSec.begin(), bytesPerSec.end());
+    sort(itemsPerSec.begin(), itemsPerSec.end());
+    res.iterations = iters;
+    res.nsPerOp = perOp[perOp.size() / 2];
+    res.minNsPerOp = perOp.front();
+    res.maxNsPerOp = perOp.back();
+    res.bytesPerSec = bytesPerSec[bytesPerSec.size() / 2];
+    res.itemsPerSec = itemsPerSec[itemsPerSec.size() / 2];
+    return res;
+}
+
+static string JsonEscape(const string& s) {
+    string out;
+    for(char c : s) {
+        if(c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if(static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+static void WriteJson(FILE* fp, const vector<BenchResult>& results, double minSec, int reps) {
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+    char date[64] = "";
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+#ifdef NDEBUG
+    const char* build = "release";
+#else
+    const char* build = "debug";
+#endif
+    fprintf(fp, "{\n  \"context\": {\"date\": \"%s\", \"host\": \"%s\", \"cpus\": %u, "
+                "\"build\": \"%s\", \"min_time_s\": %g, \"repetitions\": %d},\n  \"benchmarks\": [",
+            date, JsonEscape(host).c_str(), thread::hardware_concurrency(), build, minSec, reps);
+    for(size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(fp, "%s\n    {\"name\": \"%s\", ", i ? "," : "", JsonEscape(r.name).c_str());
+        if(r.skipped) {
+            fprintf(fp, "\"skipped\": true, \"error\": \"%s\"}", JsonEscape(r.error).c_str());
+            continue;
+        }
+        fprintf(fp, "\"iterations\": %llu, \"ns_per_op\": %.2f, \"min_ns_per_op\": %.2f, "
+                    "\"max_ns_per_op\": %.2f, \"bytes_per_second\": %.0f, \"items_per_second\": %.0f}",
+                static_cast<unsigned long long>(r.iterations), r.nsPerOp, r.minNsPerOp,
+                r.maxNsPerOp, r.bytesPerSec, r.itemsPerSec);
+    }
+    fprintf(fp, "\n  ]\n}\n");
+}
+
+static void Usage() {
+    fprintf(stderr,
+        "bench [options]\n"
+        "  -f, --filter STR     only run benchmarks whose name contains STR\n"
+        "  -t, --min-time SEC   minimum time per repetition (default 0.2)\n"
+        "  -r, --reps N         repetitions, the median is reported (default 3)\n"
+        "  -j, --json FILE      write results as JSON to FILE ('-' for stdout)\n"
+        "  -l, --list           list benchmark names and exit\n"
+        "  -h, --help           show this help\n");
+}
+
+int main(int argc, char* argv[]) {
+    static const struct option longOptions[] = {
+        {"filter",   required_argument, nullptr, 'f'},
+        {"min-time", required_argument, nullptr, 't'},
+        {"reps",     required_argument, nullptr, 'r'},
+        {"json",     required_argument, nullptr, 'j'},
+        {"list",     no_argument,       nullptr, 'l'},
+        {"help",     no_argument,       nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    string filter;
+    string jsonFile;
+    double minSec = 0.2;
+    int reps = 3;
+    bool list = false;
+    int ch;
+    while((ch = getopt_long(argc, argv, "f:t:r:j:lh", longOptions, nullptr)) != -1) {
+        switch(ch) {
+        case 'f': filter = optarg; break;
+        case 't': minSec = atof(optarg); break;
+        case 'r': reps = atoi(optarg); break;
+        case 'j': jsonFile = optarg; break;
+        case 'l': list = true; break;
+        case 'h':
+        default:
+            Usage();
+            return ch == 'h' ? 0 : 2;
+        }
+    }
+    if(minSec <= 0 || reps < 1) {
+        Usage();
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    vector<BenchResult> results;
+    /* JSON写到标准输出时，文本结果改写到标准错误 */
+    FILE* text = (jsonFile == "-") ? stderr : stdout;
+    if(!list) {
+        fprintf(text, "%-40s %12s %12s %12s %14s\n", "benchmark", "iterations", "ns/op", "MB/s", "items/s");
+    }
+    for(const BenchInfo& info : BenchRegistry()) {
+        if(!filter.empty() && info.name.find(filter) == string::npos) {
+            continue;
+        }
+        if(list) {
+            printf("%s\n", info.name.c_str());
+            continue;
+        }
+        BenchResult r = RunOne(info, minSec, reps);
+        if(r.skipped) {
+            fprintf(text, "%-40s skipped: %s\n", r.name.c_str(), r.error.c_str());
+        } else {
+            fprintf(text, "%-40s %12llu %12.1f %12.1f %14.0f\n", r.name.c_str(),
+                    static_cast<unsigned long long>(r.iterations), r.nsPerOp,
+                    r.bytesPerSec / (1 << 20), r.itemsPerSec);
+        }
+        fflush(text);
+        results.push_back(r);
+    }
+    if(list || jsonFile.empty()) {
+        return 0;
+    }
+    FILE* fp = (jsonFile == "-") ? stdout : fopen(jsonFile.c_str(), "w");
+    if(!fp) {
+        perror("open json file");
+        return 1;
+    }
+    WriteJson(fp, results, minSec, reps);
+    if(fp != stdout) {
+        fclose(fp);
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*
+ * 微基准测试框架
+ * 每个基准函数在 state.Iterations() 次循环内执行被测操作，框架自动标定迭代次数，
+ * 重复多轮取中位数，结果以文本和JSON输出，便于对比不同版本
+ */
+class BenchState {
+public:
+    typedef std::chrono::steady_clock BenchClock;
+
+    BenchState(uint64_t iterations, int64_t arg);
+
+    uint64_t Iterations() const { return iterations_; }
+    int64_t Arg() const { return arg_; }                    // 注册时传入的参数
+
+    void ResetTimer();                                      // 丢弃此前的计时（排除准备工作）
+    void PauseTiming();                                     // 暂停计时
+    void ResumeTiming();                                    // 恢复计时
+
+    void SetBytesProcessed(uint64_t bytes) { bytes_ = bytes; }  // 总处理字节数，用于计算MB/s
+    void SetItemsProcessed(uint64_t items) { items_ = items; }  // 总处理条目数，用于计算items/s
+    void SkipWithError(const std::string& msg);            // 环境不满足时跳过
+
+    uint64_t ElapsedNs() const;
+    uint64_t BytesProcessed() const { return bytes_; }
+    uint64_t ItemsProcessed() const { return items_; }
+    bool Skipped() const { return skipped_; }
+    const std::string& Error() const { return error_; }
+
+private:
+    uint64_t iterations_;
+    int64_t arg_;
+    uint64_t bytes_;
+    uint64_t items_;
+    bool running_;
+    bool skipped_;
+    std::string error_;
+    BenchClock::time_point start_;
+    BenchClock::duration elapsed_;
+};
+
+typedef void (*BenchFunc)(BenchState&);
+
+struct BenchInfo {
+    std::string name;
+    BenchFunc fn;
+    int64_t arg;
+};
+
+/* 全局注册表，基准在静态初始化阶段注册 */
+std::vector<BenchInfo>& BenchRegistry();
+
+struct BenchRegistrar {
+    BenchRegistrar(const char* name, BenchFunc fn, int64_t arg = 0);
+};
+
+/* 阻止编译器把被测结果当作无用代码消除 */
+template<class T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_UNIQUE_(a, b) BENCH_CONCAT_(a, b)
+
+/* BENCH(函数, "名称") 或 BENCH_ARG(函数, "名称", 参数) 注册一个基准 */
+#define BENCH(fn, name) \
+    static BenchRegistrar BENCH_UNIQUE_(benchRegistrar_, __LINE__)(name, fn)
+#define BENCH_ARG(fn, name, arg) \
+    static BenchRegistrar BENCH_UNIQUE_(benchRegistrar_, __LINE__)(name, fn, arg)
+
+#endif //BENCH_H
@@ -0,0 +1,132 @@
+#include "bench.h"
+#include "../buffer/buffer.h"
+#include "../buffer/ringbuffer.h"
+#include "../buffer/chainbuffer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+
+/* 追加Arg()字节后立即取走，只测Append本身 */
+template<class BufferT>
+static void BenchBufferAppend(BenchState& state) {
+    BufferT buff;
+    std::string data(state.Arg(), 'x');
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        buff.Append(data);
+        buff.RetrieveAll();
+    }
+    state.SetBytesProcessed(state.Iterations() * data.size());
+}
+BENCH_ARG(BenchBufferAppend<Buffer>, "Buffer/Append/16", 16);
+BENCH_ARG(BenchBufferAppend<Buffer>, "Buffer/Append/256", 256);
+BENCH_ARG(BenchBufferAppend<Buffer>, "Buffer/Append/4096", 4096);
+BENCH_ARG(BenchBufferAppend<RingBuffer>, "RingBuffer/Append/16", 16);
+BENCH_ARG(BenchBufferAppend<RingBuffer>, "RingBuffer/Append/256", 256);
+BENCH_ARG(BenchBufferAppend<RingBuffer>, "RingBuffer/Append/4096", 4096);
+BENCH_ARG(BenchBufferAppend<ChainBuffer>, "ChainBuffer/Append/16", 16);
+BENCH_ARG(BenchBufferAppend<ChainBuffer>, "ChainBuffer/Append/256", 256);
+BENCH_ARG(BenchBufferAppend<ChainBuffer>, "ChainBuffer/Append/4096", 4096);
+
+/* 从1KB开始追加到64KB，覆盖MakeSpace_的扩容路径 */
+static void BenchBufferMakeSpaceGrow(BenchState& state) {
+    char chunk[1024] = {0};
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        Buffer buff(1024);
+        for(int j = 0; j < 64; j++) {
+            buff.Append(chunk, sizeof(chunk));
+        }
+        DoNotOptimize(buff.Peek());
+    }
+    state.SetBytesProcessed(state.Iterations() * 64 * sizeof(chunk));
+}
+BENCH(BenchBufferMakeSpaceGrow, "Buffer/MakeSpace/Grow64K");
+
+/* 始终保留Arg()字节未读：Buffer写满后MakeSpace_把未读数据搬回头部，RingBuffer直接绕回 */
+template<class BufferT>
+static void BenchBufferMakeSpaceCompact(BenchState& state) {
+    BufferT buff;
+    buff.EnsureWriteable(4096);
+    std::string pending(state.Arg(), 'p');
+    char chunk[1024] = {0};
+    buff.Append(pending);
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        buff.Append(chunk, sizeof(chunk));
+        buff.Retrieve(sizeof(chunk));
+    }
+    state.SetBytesProcessed(state.Iterations() * sizeof(chunk));
+}
+BENCH_ARG(BenchBufferMakeSpaceCompact<Buffer>, "Buffer/MakeSpace/Compact512", 512);
+BENCH_ARG(BenchBufferMakeSpaceCompact<RingBuffer>, "RingBuffer/Wrap512", 512);
+
+/* 从管道读取Arg()字节，写管道的时间不计入 */
+template<class BufferT>
+static void BenchBufferReadFd(BenchState& state) {
+    int fds[2];
+    if(pipe(fds) < 0) {
+        state.SkipWithError("pipe failed");
+        return;
+    }
+    fcntl(fds[0], F_SETPIPE_SZ, 1 << 20);
+    std::string data(state.Arg(), 'r');
+    BufferT buff;
+    int err = 0;
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        state.PauseTiming();
+        if(write(fds[1], data.data(), data.size()) != static_cast<ssize_t>(data.size())) {
+            state.SkipWithError("short pipe write");
+            break;
+        }
+        state.ResumeTiming();
+        /* 单次readv的容量可能小于Arg()（ChainBuffer），读到数据取完为止 */
+        while(buff.ReadableBytes() < data.size() && buff.ReadFd(fds[0], &err) > 0) {}
+        buff.RetrieveAll();
+    }
+    state.SetBytesProcessed(state.Iterations() * data.size());
+    close(fds[0]);
+    close(fds[1]);
+}
+BENCH_ARG(BenchBufferReadFd<Buffer>, "Buffer/ReadFd/512", 512);
+BENCH_ARG(BenchBufferReadFd<Buffer>, "Buffer/ReadFd/16384", 16384);
+BENCH_ARG(BenchBufferReadFd<Buffer>, "Buffer/ReadFd/131072", 131072);
+BENCH_ARG(BenchBufferReadFd<RingBuffer>, "RingBuffer/ReadFd/512", 512);
+BENCH_ARG(BenchBufferReadFd<RingBuffer>, "RingBuffer/ReadFd/16384", 16384);
+BENCH_ARG(BenchBufferReadFd<RingBuffer>, "RingBuffer/ReadFd/131072", 131072);
+BENCH_ARG(BenchBufferReadFd<ChainBuffer>, "ChainBuffer/ReadFd/512", 512);
+BENCH_ARG(BenchBufferReadFd<ChainBuffer>, "ChainBuffer/ReadFd/16384", 16384);
+BENCH_ARG(BenchBufferReadFd<ChainBuffer>, "ChainBuffer/ReadFd/131072", 131072);
+
+/* 长连接上的大上传：每轮读入Arg()字节，读完后像空闲连接一样缩回1KB，
+   覆盖溢出到额外缓冲区后的二次拷贝和逐次扩容 */
+static void BenchBufferUpload(BenchState& state) {
+    int fds[2];
+    if(pipe(fds) < 0) {
+        state.SkipWithError("pipe failed");
+        return;
+    }
+    fcntl(fds[0], F_SETPIPE_SZ, 1 << 20);
+    std::string data(state.Arg(), 'u');
+    Buffer buff;
+    int err = 0;
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        state.PauseTiming();
+        if(write(fds[1], data.data(), data.size()) != static_cast<ssize_t>(data.size())) {
+            state.SkipWithError("short pipe write");
+            break;
+        }
+        state.ResumeTiming();
+        while(buff.ReadableBytes() < data.size() && buff.ReadFd(fds[0], &err) > 0) {}
+        buff.RetrieveAll();
+        buff.Shrink(1024);
+    }
+    state.SetBytesProcessed(state.Iterations() * data.size());
+    close(fds[0]);
+    close(fds[1]);
+}
+BENCH_ARG(BenchBufferUpload, "Buffer/Upload/256K", 256 << 10);
+BENCH_ARG(BenchBufferUpload, "Buffer/Upload/1M", 1 << 20);
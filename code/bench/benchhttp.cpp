@@ -0,0 +1,164 @@
+#include "bench.h"
+#include "../http/httprequest.h"
+#include "../http/httpresponse.h"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+
+/* 典型请求样本：命令行工具、浏览器、表单提交（非登录路径，不访问数据库） */
+static const char* REQUEST_CORPUS[] = {
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: localhost:1316\r\n"
+    "User-Agent: curl/7.81.0\r\n"
+    "Accept: */*\r\n"
+    "\r\n",
+
+    "GET /picture HTTP/1.1\r\n"
+    "Host: localhost:1316\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+    "Chrome/120.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,"
+    "*/*;q=0.8\r\n"
+    "Referer: http://localhost:1316/index.html\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "Cookie: session=5f2b8c1e9a7d4e3b; theme=dark\r\n"
+    "\r\n",
+
+    "POST /submit HTTP/1.1\r\n"
+    "Host: localhost:1316\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "Content-Length: 45\r\n"
+    "\r\n"
+    "name=%E6%B5%8B%E8%AF%95&value=123&comment=a+b",
+};
+
+static void BenchHttpRequestParse(BenchState& state) {
+    std::string raw = REQUEST_CORPUS[state.Arg()];
+    Buffer buff;
+    HttpRequest request;
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        buff.Append(raw);
+        request.Init();
+        DoNotOptimize(request.parse(buff));
+        buff.RetrieveAll();
+    }
+    state.SetBytesProcessed(state.Iterations() * raw.size());
+}
+BENCH_ARG(BenchHttpRequestParse, "HttpRequest/Parse/CurlGet", 0);
+BENCH_ARG(BenchHttpRequestParse, "HttpRequest/Parse/BrowserGet", 1);
+BENCH_ARG(BenchHttpRequestParse, "HttpRequest/Parse/FormPost", 2);
+
+/*
+ * 长连接上连续到达的大POST：每轮请求体Arg()字节，按16KB分片写入管道，
+ * 每次ReadFd后增量解析。分片与请求边界不对齐，缓冲区里总留有下一个请求的开头，
+ * Buffer在空间不足时要搬移这部分数据，RingBuffer只移动下标，ChainBuffer读空的块直接归还
+ */
+template<class BufferT>
+static void BenchLargePost(BenchState& state) {
+    const size_t CHUNK = 16384;
+    std::string body = "data=" + std::string(state.Arg() - 5, 'v');
+    std::string req = "POST /upload HTTP/1.1\r\n"
+                      "Host: localhost:1316\r\n"
+                      "Connection: keep-alive\r\n"
+                      "Content-Type: application/octet-stream\r\n"
+                      "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    /* 两个请求拼在一起循环发送，使分片边界在请求间不断漂移 */
+    std::string stream = req + req;
+    int fds[2];
+    if(pipe(fds) < 0) {
+        state.SkipWithError("pipe failed");
+        return;
+    }
+    fcntl(fds[0], F_SETPIPE_SZ, 1 << 20);
+    BufferT buff;
+    HttpRequest request;
+    size_t off = 0;
+    uint64_t done = 0;
+    int err = 0;
+    state.ResetTimer();
+    while(done < state.Iterations()) {
+        state.PauseTiming();
+        size_t n = std::min(CHUNK, stream.size() - off);
+        if(write(fds[1], stream.data() + off, n) != static_cast<ssize_t>(n)) {
+            state.SkipWithError("short pipe write");
+            break;
+        }
+        off = (off + n) % stream.size();
+        state.ResumeTiming();
+        buff.ReadFd(fds[0], &err);
+        while(buff.ReadableBytes() && request.parse(buff) && request.IsFinish()) {
+            done++;
+            request.Init();
+        }
+    }
+    state.SetBytesProcessed(done * req.size());
+    close(fds[0]);
+    close(fds[1]);
+}
+BENCH_ARG(BenchLargePost<Buffer>, "HttpRequest/LargePost/Vector/64K", 65536);
+BENCH_ARG(BenchLargePost<RingBuffer>, "HttpRequest/LargePost/Ring/64K", 65536);
+BENCH_ARG(BenchLargePost<Buffer>, "HttpRequest/LargePost/Vector/1M", 1 << 20);
+BENCH_ARG(BenchLargePost<RingBuffer>, "HttpRequest/LargePost/Ring/1M", 1 << 20);
+BENCH_ARG(BenchLargePost<ChainBuffer>, "HttpRequest/LargePost/Chain/64K", 65536);
+BENCH_ARG(BenchLargePost<ChainBuffer>, "HttpRequest/LargePost/Chain/1M", 1 << 20);
+
+/* 在当前目录或上级目录中查找resources */
+static std::string FindSrcDir() {
+    const char* candidates[] = { "./resources/", "../resources/", "../../resources/" };
+    for(const char* dir : candidates) {
+        struct stat st;
+        if(stat(dir, &st) == 0 && S_ISDIR(st.st_mode)) {
+            return dir;
+        }
+    }
+    return "";
+}
+
+static const char* RESPONSE_PATHS[] = { "/index.html", "/not_exist.html" };
+
+/* Arg()为0时响应存在的文件，为1时走404错误页 */
+static void BenchHttpResponseMakeFile(BenchState& state) {
+    std::string srcDir = FindSrcDir();
+    if(srcDir.empty()) {
+        state.SkipWithError("resources directory not found");
+        return;
+    }
+    Buffer buff;
+    HttpResponse response;
+    std::string path = RESPONSE_PATHS[state.Arg()];
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        response.Init(srcDir, path, true, 200);
+        response.MakeResponse(buff);
+        DoNotOptimize(response.File());
+        buff.RetrieveAll();
+    }
+    response.UnmapFile();
+}
+BENCH_ARG(BenchHttpResponseMakeFile, "HttpResponse/MakeResponse/File", 0);
+BENCH_ARG(BenchHttpResponseMakeFile, "HttpResponse/MakeResponse/NotFound", 1);
+
+template<class BufferT>
+static void BenchHttpResponseMakeBody(BenchState& state) {
+    std::string body(state.Arg(), 'b');
+    std::string path = "/metrics";
+    BufferT buff;
+    HttpResponse response;
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        response.Init("./", path, true, 200);
+        response.MakeResponse(buff, body, "text/plain");
+        buff.RetrieveAll();
+    }
+    state.SetBytesProcessed(state.Iterations() * body.size());
+}
+BENCH_ARG(BenchHttpResponseMakeBody<Buffer>, "HttpResponse/MakeResponse/Body1K", 1024);
+BENCH_ARG(BenchHttpResponseMakeBody<ChainBuffer>, "HttpResponse/MakeResponse/Chain/Body1K", 1024);
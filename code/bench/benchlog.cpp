@@ -0,0 +1,64 @@
+#include "bench.h"
+#include "../log/log.h"
+
+#include <dirent.h>
+#include <unistd.h>
+#include <string>
+
+static const char* BENCH_LOG_DIR = "/tmp/webserver_bench_log";
+
+/* 删除已轮转的日志文件，避免长时间压测占满磁盘 */
+static void CleanLogDir() {
+    DIR* dir = opendir(BENCH_LOG_DIR);
+    if(!dir) { return; }
+    struct dirent* ent;
+    while((ent = readdir(dir)) != nullptr) {
+        if(ent->d_name[0] == '.') { continue; }
+        std::string file = std::string(BENCH_LOG_DIR) + "/" + ent->d_name;
+        unlink(file.c_str());
+    }
+    closedir(dir);
+}
+
+/*
+ * Arg()为异步队列容量，0表示同步写
+ * 异步模式使用阻塞策略，稳态下测到的是写线程能承受的单行成本
+ */
+static void BenchLogWrite(BenchState& state) {
+    Log* log = Log::Instance();
+    log->init(0, BENCH_LOG_DIR, ".log", static_cast<int>(state.Arg()), Log::OVERFLOW_BLOCK);
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        log->write(1, "Client[%d](%s:%d) in!", static_cast<int>(i & 0xffff), "127.0.0.1", 52814);
+    }
+    log->flush();
+    state.PauseTiming();
+    CleanLogDir();
+    state.SetItemsProcessed(state.Iterations());
+}
+BENCH_ARG(BenchLogWrite, "Log/Write/Sync", 0);
+BENCH_ARG(BenchLogWrite, "Log/Write/Async", 1024);
+
+/* 经由LOG_INFO宏，包含等级判断与每行的flush */
+static void BenchLogMacro(BenchState& state) {
+    Log::Instance()->init(1, BENCH_LOG_DIR, ".log", static_cast<int>(state.Arg()), Log::OVERFLOW_BLOCK);
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        LOG_INFO("Client[%d](%s:%d) in!", static_cast<int>(i & 0xffff), "127.0.0.1", 52814);
+    }
+    state.PauseTiming();
+    CleanLogDir();
+    state.SetItemsProcessed(state.Iterations());
+}
+BENCH_ARG(BenchLogMacro, "Log/Macro/Async", 1024);
+
+/* 低于日志等级的调用只应付出一次等级判断的代价 */
+static void BenchLogFiltered(BenchState& state) {
+    Log::Instance()->init(1, BENCH_LOG_DIR, ".log", 1024, Log::OVERFLOW_BLOCK);
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        LOG_DEBUG("Client[%d](%s:%d) in!", static_cast<int>(i & 0xffff), "127.0.0.1", 52814);
+    }
+    state.SetItemsProcessed(state.Iterations());
+}
+BENCH(BenchLogFiltered, "Log/Macro/Filtered");
@@ -0,0 +1,21 @@
+#include "bench.h"
+#include "../pool/threadpool.h"
+
+#include <atomic>
+
+/* 单个生产者提交空任务，计时到所有任务执行完为止，Arg()为工作线程数 */
+static void BenchThreadPoolAddTask(BenchState& state) {
+    ThreadPool pool(state.Arg());
+    std::atomic<uint64_t> done(0);
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        pool.AddTask([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+    }
+    while(done.load(std::memory_order_relaxed) < state.Iterations()) {
+        std::this_thread::yield();
+    }
+    state.SetItemsProcessed(state.Iterations());
+}
+BENCH_ARG(BenchThreadPoolAddTask, "ThreadPool/AddTask/1", 1);
+BENCH_ARG(BenchThreadPoolAddTask, "ThreadPool/AddTask/4", 4);
+BENCH_ARG(BenchThreadPoolAddTask, "ThreadPool/AddTask/8", 8);
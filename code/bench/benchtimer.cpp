@@ -0,0 +1,68 @@
+#include "bench.h"
+#include "../timer/heaptimer.h"
+
+#include <random>
+#include <vector>
+
+/* 每轮向空堆中加入Arg()个超时各不相同的定时器 */
+static void BenchHeapTimerAdd(BenchState& state) {
+    int n = static_cast<int>(state.Arg());
+    std::mt19937 rng(1);
+    std::vector<int> timeouts(n);
+    for(int i = 0; i < n; i++) {
+        timeouts[i] = 1000 + static_cast<int>(rng() % 60000);
+    }
+    HeapTimer timer;
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        for(int id = 0; id < n; id++) {
+            timer.add(id, timeouts[id], []() {});
+        }
+        state.PauseTiming();
+        timer.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.Iterations() * n);
+}
+BENCH_ARG(BenchHeapTimerAdd, "HeapTimer/Add/1000", 1000);
+BENCH_ARG(BenchHeapTimerAdd, "HeapTimer/Add/10000", 10000);
+
+/* 堆中有Arg()个定时器，按服务器的用法随机续期同一超时时间 */
+static void BenchHeapTimerAdjust(BenchState& state) {
+    int n = static_cast<int>(state.Arg());
+    HeapTimer timer;
+    for(int id = 0; id < n; id++) {
+        timer.add(id, 60000, []() {});
+    }
+    std::mt19937 rng(2);
+    std::vector<int> ids(4096);
+    for(auto& id : ids) {
+        id = static_cast<int>(rng() % n);
+    }
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        timer.adjust(ids[i % ids.size()], 60000);
+    }
+    state.SetItemsProcessed(state.Iterations());
+}
+BENCH_ARG(BenchHeapTimerAdjust, "HeapTimer/Adjust/1000", 1000);
+BENCH_ARG(BenchHeapTimerAdjust, "HeapTimer/Adjust/10000", 10000);
+
+/* 每轮放入Arg()个已到期的定时器，tick一次全部触发 */
+static void BenchHeapTimerTick(BenchState& state) {
+    int n = static_cast<int>(state.Arg());
+    HeapTimer timer;
+    uint64_t fired = 0;
+    state.ResetTimer();
+    for(uint64_t i = 0; i < state.Iterations(); i++) {
+        state.PauseTiming();
+        for(int id = 0; id < n; id++) {
+            timer.add(id, 0, [&fired]() { fired++; });
+        }
+        state.ResumeTiming();
+        timer.tick();
+    }
+    DoNotOptimize(fired);
+    state.SetItemsProcessed(state.Iterations() * n);
+}
+BENCH_ARG(BenchHeapTimerTick, "HeapTimer/Tick/1000", 1000);
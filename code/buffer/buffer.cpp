@@ -1,25 +1,20 @@
 #include "buffer.h"
+#include <algorithm>
 
-Buffer::Buffer(int initBuffSize) : buffer_(initBuffSize), readPos_(0), writePos_(0) {}
+const size_t Buffer::EXTRA_BUFF_SIZE;
+const size_t Buffer::MAX_READ_HINT;
 
-size_t Buffer::ReadableBytes() const {
-    return writePos_ - readPos_;
-}
-size_t Buffer::WritableBytes() const {
-    return buffer_.size() - writePos_;
-}
-
-size_t Buffer::PrependableBytes() const {
-    return readPos_;
-}
-
-const char* Buffer::Peek() const {
-    return BeginPtr_() + readPos_;
+Buffer::Buffer(int initBuffSize) : chunk_(nullptr), initSize_(initBuffSize > 0 ? initBuffSize : 0),
+                                   readPos_(0), writePos_(0), readHint_(0) {
+    /* 先构造内存池，保证它晚于所有缓冲区析构（包括单例中的缓冲区） */
+    ChunkPool::Instance();
+#ifndef NDEBUG
+    owner_.store(std::thread::id());
+#endif
 }
 
-void Buffer::Retrieve(size_t len) {
-    assert(len <= ReadableBytes());
-    readPos_ += len;
+Buffer::~Buffer() {
+    ChunkPool::Instance()->Release(chunk_);
 }
 
 void Buffer::RetrieveUntil(const char* end) {
@@ -28,7 +23,7 @@ void Buffer::RetrieveUntil(const char* end) {
 }
 
 void Buffer::RetrieveAll() {
-    bzero(&buffer_[0], buffer_.size());
+    BUFFER_OWNER_CHECK();
     readPos_ = 0;
     writePos_ = 0;
 }
@@ -39,18 +34,6 @@ std::string Buffer::RetrieveAllToStr() {
     return str;
 }
 
-const char* Buffer::BeginWriteConst() const {
-    return BeginPtr_() + writePos_;
-}
-
-char* Buffer::BeginWrite() {
-    return BeginPtr_() + writePos_;
-}
-
-void Buffer::HasWritten(size_t len) {
-    writePos_ += len;
-} 
-
 void Buffer::Append(const std::string& str) {
     Append(str.data(), str.length());
 }
@@ -61,6 +44,7 @@ void Buffer::Append(const void* data, size_t len) {
 }
 
 void Buffer::Append(const char* str, size_t len) {
+    BUFFER_OWNER_CHECK();
     assert(str);
     EnsureWriteable(len);
     std::copy(str, str + len, BeginWrite());
@@ -68,10 +52,12 @@ void Buffer::Append(const char* str, size_t len) {
 }
 
 void Buffer::Append(const Buffer& buff) {
+    if(buff.ReadableBytes() == 0) { return; }   // 还没分配存储的缓冲区Peek()为空指针
     Append(buff.Peek(), buff.ReadableBytes());
 }
 
 void Buffer::EnsureWriteable(size_t len) {
+    BUFFER_OWNER_CHECK();
     if(WritableBytes() < len) {
         MakeSpace_(len);
     }
@@ -79,14 +65,23 @@ void Buffer::EnsureWriteable(size_t len) {
 }
 
 ssize_t Buffer::ReadFd(int fd, int* saveErrno) {
-    char buff[65535];
+    BUFFER_OWNER_CHECK();
+    /* 溢出部分先读到线程局部的缓冲区，不再每次在栈上放64KB */
+    static thread_local char extraBuff[EXTRA_BUFF_SIZE];
+    /* 之前的读取出现过溢出时，先按读取规模预留空间，让数据直接读进缓冲区，省去溢出后的二次拷贝 */
+    if(readHint_ > WritableBytes()) {
+        EnsureWriteable(readHint_);
+    } else if(!chunk_) {
+        /* 空闲时已归还存储：先从池中取回，数据直接读进来 */
+        EnsureWriteable(initSize_);
+    }
     struct iovec iov[2];
     const size_t writable = WritableBytes();
     /* 分散读， 保证数据全部读完 */
     iov[0].iov_base = BeginPtr_() + writePos_;
     iov[0].iov_len = writable;
-    iov[1].iov_base = buff;
-    iov[1].iov_len = sizeof(buff);
+    iov[1].iov_base = extraBuff;
+    iov[1].iov_len = sizeof(extraBuff);
 
     const ssize_t len = readv(fd, iov, 2);
     if(len < 0) {
@@ -94,15 +89,22 @@ ssize_t Buffer::ReadFd(int fd, int* saveErrno) {
     }
     else if(static_cast<size_t>(len) <= writable) {
         writePos_ += len;
+        /* 缓冲区中的数据远小于预留空间时减半，避免一次大请求后一直按大块预留 */
+        if(ReadableBytes() < readHint_ / 8) {
+            readHint_ /= 2;
+        }
     }
     else {
-        writePos_ = buffer_.size();
-        Append(buff, len - writable);
+        writePos_ = Capacity();
+        Append(extraBuff, len - writable);
+        /* 发生溢出：按目前积累的未读数据量（即观察到的请求规模）预留 */
+        readHint_ = std::min(MAX_READ_HINT, std::max(readHint_, ReadableBytes()));
     }
     return len;
 }
 
 ssize_t Buffer::WriteFd(int fd, int* saveErrno) {
+    BUFFER_OWNER_CHECK();
     size_t readSize = ReadableBytes();
     ssize_t len = write(fd, Peek(), readSize);
     if(len < 0) {
@@ -113,17 +115,45 @@ ssize_t Buffer::WriteFd(int fd, int* saveErrno) {
     return len;
 }
 
-char* Buffer::BeginPtr_() {
-    return &*buffer_.begin();
-}
-
-const char* Buffer::BeginPtr_() const {
-    return &*buffer_.begin();
+void Buffer::Shrink(size_t keep) {
+    BUFFER_OWNER_CHECK();
+    size_t readable = ReadableBytes();
+    if(Capacity() <= std::max(keep, readable)) {
+        return;
+    }
+    if(readable == 0) {
+        /* 整块还给池，下次读写时再从池中取，不反复向系统申请也不清零 */
+        ChunkPool::Instance()->Release(chunk_);
+        chunk_ = nullptr;
+        readPos_ = writePos_ = 0;
+        return;
+    }
+    ChunkPool::Chunk* chunk = ChunkPool::Instance()->Acquire(std::max(keep, readable));
+    if(chunk->cap >= Capacity()) {
+        /* 落在同一尺寸类，换了也不会变小 */
+        ChunkPool::Instance()->Release(chunk);
+        return;
+    }
+    memcpy(chunk->Data(), Peek(), readable);
+    ChunkPool::Instance()->Release(chunk_);
+    chunk_ = chunk;
+    readPos_ = 0;
+    writePos_ = readable;
 }
 
 void Buffer::MakeSpace_(size_t len) {
     if(WritableBytes() + PrependableBytes() < len) {
-        buffer_.resize(writePos_ + len + 1);
+        /* 换一块更大的：至少翻倍，避免逐步追加时反复搬移 */
+        size_t readable = ReadableBytes();
+        size_t size = std::max(std::max(readable + len, Capacity() * 2), initSize_);
+        ChunkPool::Chunk* chunk = ChunkPool::Instance()->Acquire(size);
+        if(readable > 0) {
+            memcpy(chunk->Data(), Peek(), readable);
+        }
+        ChunkPool::Instance()->Release(chunk_);
+        chunk_ = chunk;
+        readPos_ = 0;
+        writePos_ = readable;
     } 
     else {
         size_t readable = ReadableBytes();
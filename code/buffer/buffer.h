@@ -4,31 +4,59 @@
 #include <iostream>
 #include <unistd.h>  // write
 #include <sys/uio.h> //readv
-#include <vector> //readv
-#include <atomic>
 #include <assert.h>
+#include "chunkpool.h"
+#ifndef NDEBUG
+#include <atomic>
+#include <thread>
+#endif
+
+#ifndef NDEBUG
+#define BUFFER_OWNER_CHECK() OwnerCheck_ ownerCheck(this)
+#else
+#define BUFFER_OWNER_CHECK()
+#endif
+
+/*
+ * 单一所有者的缓冲区：同一时刻只被一个线程使用（连接的读写缓冲区由持有该连接的线程访问，
+ * 日志缓冲区在mtx_保护下访问），读写下标是普通的size_t，不使用原子操作
+ * 调试构建（未定义NDEBUG）下检测两个线程同时进入缓冲区的方法
+ * 存储是一块从 ChunkPool 借来的内存，第一次写入时才借，扩容时换一块更大的；
+ * Shrink 把空闲缓冲区的整块还给池，长连接空闲时不占内存，再次读写时从池中取回
+ */
 class Buffer {
 public:
-    // 构造函数，初始化缓冲区大小
+    // 构造函数，initBuffSize为第一次写入时至少分配的大小
     Buffer(int initBuffSize = 1024);
-    ~Buffer() = default;
+    ~Buffer();
 
-    size_t WritableBytes() const;       //返回可写入的字节数
-    size_t ReadableBytes() const ;      //返回可读的字节数
-    size_t PrependableBytes() const;    //返回可追加的字节数
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
 
-    const char* Peek() const;           //返回缓冲区当前读取位置的指针
+    size_t WritableBytes() const { return Capacity() - writePos_; }         //返回可写入的字节数
+    size_t ReadableBytes() const { return writePos_ - readPos_; }           //返回可读的字节数
+    size_t PrependableBytes() const { return readPos_; }                    //返回可追加的字节数
+
+    const char* Peek() const { return BeginPtr_() + readPos_; }             //返回缓冲区当前读取位置的指针
     void EnsureWriteable(size_t len);   //确保缓冲区有足够的空间写入len字节
-    void HasWritten(size_t len);        //标记len字节已被写入
+    void HasWritten(size_t len) {       //标记len字节已被写入
+        BUFFER_OWNER_CHECK();
+        assert(len <= WritableBytes());
+        writePos_ += len;
+    }
 
-    void Retrieve(size_t len);          //读取 len 个字节并移动读取位置
+    void Retrieve(size_t len) {         //读取 len 个字节并移动读取位置
+        BUFFER_OWNER_CHECK();
+        assert(len <= ReadableBytes());
+        readPos_ += len;
+    }
     void RetrieveUntil(const char* end);//读取直到遇到 end 指针所指的位置
 
-    void RetrieveAll() ;                //清空缓冲区
+    void RetrieveAll() ;                //清空缓冲区（只重置下标，不清零）
     std::string RetrieveAllToStr();     //读取整个缓冲区并返回一个字符串
 
-    const char* BeginWriteConst() const;//返回缓冲区当前写入位置的指针
-    char* BeginWrite();                 //返回缓冲区当前写入位置的指针
+    const char* BeginWriteConst() const { return BeginPtr_() + writePos_; } //返回缓冲区当前写入位置的指针
+    char* BeginWrite() { return BeginPtr_() + writePos_; }                  //返回缓冲区当前写入位置的指针
 
     void Append(const std::string& str);        //追加一个字符串到缓冲区
     void Append(const char* str, size_t len);   //追加一个字符数组到缓冲区
@@ -38,14 +66,45 @@ public:
     ssize_t ReadFd(int fd, int* Errno);     // 从文件描述符 fd 读取数据到缓冲区
     ssize_t WriteFd(int fd, int* Errno);    // 从文件描述符 fd 写入数据到缓冲区
 
+    size_t Capacity() const { return chunk_ ? chunk_->cap : 0; }
+    void Shrink(size_t keep);               // 容量超过keep时：没有数据则整块还给池，否则换一块容纳max(keep, 可读字节数)的小块
+
 private:
-    char* BeginPtr_();              //返回缓冲区的起始指针
-    const char* BeginPtr_() const;  //返回缓冲区的起始指针（常量版本）
+    char* BeginPtr_() { return chunk_ ? chunk_->Data() : nullptr; }             //返回缓冲区的起始指针
+    const char* BeginPtr_() const { return chunk_ ? chunk_->Data() : nullptr; } //返回缓冲区的起始指针（常量版本）
     void MakeSpace_(size_t len);    //确保缓冲区有足够的空间写入len字节，如果没有则扩展缓冲区
 
-    std::vector<char> buffer_;           //缓冲区数据存储
-    std::atomic<std::size_t> readPos_;   //读取位置
-    std::atomic<std::size_t> writePos_;  //写入位置
+    static const size_t EXTRA_BUFF_SIZE = 65536;    //ReadFd溢出部分的线程局部缓冲区大小
+    static const size_t MAX_READ_HINT = 1 << 20;    //预留可写空间的上限
+
+    ChunkPool::Chunk* chunk_;       //缓冲区数据存储，为空表示还没分配或已归还
+    size_t initSize_;               //第一次分配的最小大小
+    size_t readPos_;                //读取位置
+    size_t writePos_;               //写入位置
+    size_t readHint_;               //ReadFd前预留的可写空间，按实际读到的大小增减
+
+#ifndef NDEBUG
+    /* 进入方法时登记当前线程，已被其他线程登记则断言失败；同一线程嵌套调用不重复登记 */
+    class OwnerCheck_ {
+    public:
+        explicit OwnerCheck_(const Buffer* buff) : buff_(buff), outer_(false) {
+            std::thread::id expected;
+            std::thread::id self = std::this_thread::get_id();
+            if(buff_->owner_.compare_exchange_strong(expected, self)) {
+                outer_ = true;
+            } else {
+                assert(expected == self && "Buffer used by two threads at once");
+            }
+        }
+        ~OwnerCheck_() {
+            if(outer_) { buff_->owner_.store(std::thread::id()); }
+        }
+    private:
+        const Buffer* buff_;
+        bool outer_;
+    };
+    mutable std::atomic<std::thread::id> owner_;    //正在访问缓冲区的线程
+#endif
 };
 
 #endif //BUFFER_H
\ No newline at end of file
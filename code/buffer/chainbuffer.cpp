@@ -0,0 +1,225 @@
+#include "chainbuffer.h"
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
+ChainBuffer::ChainBuffer() : readable_(0) {}
+
+ChainBuffer::~ChainBuffer() {
+    ReleaseAll_();
+}
+
+const char* ChainBuffer::Peek() const {
+    if(slices_.empty()) {
+        return nullptr;
+    }
+    const Slice& s = slices_.front();
+    return s.chunk->Data() + s.read;
+}
+
+const char* ChainBuffer::BeginWriteConst() const {
+    if(slices_.empty()) {
+        return nullptr;
+    }
+    const Slice& s = slices_.front();
+    return s.chunk->Data() + s.write;
+}
+
+bool ChainBuffer::PullupNext() {
+    if(slices_.size() < 2) {
+        return false;
+    }
+    Slice& first = slices_[0];
+    Slice& second = slices_[1];
+    const size_t maxLen = ChunkPool::CHUNK_SIZE[ChunkPool::CLASS_NUM - 1];
+    size_t firstLen = first.write - first.read;
+    if(firstLen >= maxLen) {
+        return false;
+    }
+    /* 合并后不超过最大尺寸类，第二块放不下的部分留在原处，合并块始终来自池中 */
+    size_t n = std::min(second.write - second.read, maxLen - firstLen);
+    if(first.chunk->cap - first.write < n) {
+        /* 第一块尾部放不下，换一块能容纳两段数据的块 */
+        ChunkPool::Chunk* merged = ChunkPool::Instance()->Acquire(firstLen + n);
+        memcpy(merged->Data(), first.chunk->Data() + first.read, firstLen);
+        ChunkPool::Instance()->Release(first.chunk);
+        first.chunk = merged;
+        first.read = 0;
+        first.write = firstLen;
+    }
+    memcpy(first.chunk->Data() + first.write, second.chunk->Data() + second.read, n);
+    first.write += n;
+    second.read += n;
+    if(second.read == second.write) {
+        ChunkPool::Instance()->Release(second.chunk);
+        slices_.erase(slices_.begin() + 1);
+    }
+    return true;
+}
+
+void ChainBuffer::PopFront_() {
+    ChunkPool::Instance()->Release(slices_.front().chunk);
+    slices_.pop_front();
+}
+
+void ChainBuffer::Retrieve(size_t len) {
+    assert(len <= ReadableBytes());
+    readable_ -= len;
+    while(len > 0) {
+        Slice& s = slices_.front();
+        size_t n = std::min(len, s.write - s.read);
+        s.read += n;
+        len -= n;
+        if(s.read == s.write) {
+            if(slices_.size() == 1) {
+                /* 最后一块不归还，从头开始接着写 */
+                s.read = s.write = 0;
+            } else {
+                PopFront_();
+            }
+        }
+    }
+}
+
+void ChainBuffer::RetrieveUntil(const char* end) {
+    assert(Peek() <= end && end <= BeginWriteConst());
+    Retrieve(end - Peek());
+}
+
+void ChainBuffer::RetrieveAll() {
+    while(slices_.size() > 1) {
+        PopFront_();
+    }
+    if(!slices_.empty()) {
+        slices_.front().read = slices_.front().write = 0;
+    }
+    readable_ = 0;
+}
+
+void ChainBuffer::Shrink() {
+    if(readable_ == 0) {
+        ReleaseAll_();
+    }
+}
+
+void ChainBuffer::ReleaseAll_() {
+    while(!slices_.empty()) {
+        PopFront_();
+    }
+    readable_ = 0;
+}
+
+std::string ChainBuffer::RetrieveToStr(size_t len) {
+    assert(len <= ReadableBytes());
+    std::string str;
+    str.reserve(len);
+    size_t left = len;
+    for(size_t i = 0; left > 0; i++) {
+        const Slice& s = slices_[i];
+        size_t n = std::min(left, s.write - s.read);
+        str.append(s.chunk->Data() + s.read, n);
+        left -= n;
+    }
+    Retrieve(len);
+    return str;
+}
+
+std::string ChainBuffer::RetrieveAllToStr() {
+    return RetrieveToStr(ReadableBytes());
+}
+
+void ChainBuffer::Append(const std::string& str) {
+    Append(str.data(), str.length());
+}
+
+void ChainBuffer::Append(const void* data, size_t len) {
+    assert(data);
+    Append(static_cast<const char*>(data), len);
+}
+
+void ChainBuffer::Append(const char* str, size_t len) {
+    assert(str || len == 0);
+    while(len > 0) {
+        if(slices_.empty() || slices_.back().write == slices_.back().chunk->cap) {
+            /* 按剩余长度挑选尺寸类，最大64KB */
+            size_t want = std::min(len, ChunkPool::CHUNK_SIZE[ChunkPool::CLASS_NUM - 1]);
+            slices_.push_back({ChunkPool::Instance()->Acquire(want), 0, 0});
+        }
+        Slice& s = slices_.back();
+        size_t n = std::min(len, s.chunk->cap - s.write);
+        memcpy(s.chunk->Data() + s.write, str, n);
+        s.write += n;
+        readable_ += n;
+        str += n;
+        len -= n;
+    }
+}
+
+ssize_t ChainBuffer::ReadFd(int fd, int* saveErrno) {
+    /* 读入位置：最后一块的剩余空间，没有时借一块（缓冲区为空时借4KB，多数请求能一次放下，否则借64KB），
+       再加一块栈上缓冲兜底，单次readv的容量与Buffer相当。栈上缓冲读到数据时才从池中取块追加，
+       每次读最多进池一次 */
+    char extra[65536];
+    struct iovec iov[2];
+    ChunkPool::Chunk* fresh = nullptr;
+    if(!slices_.empty() && slices_.back().write < slices_.back().chunk->cap) {
+        Slice& tail = slices_.back();
+        iov[0].iov_base = tail.chunk->Data() + tail.write;
+        iov[0].iov_len = tail.chunk->cap - tail.write;
+    } else {
+        fresh = ChunkPool::Instance()->Acquire(readable_ == 0 ? ChunkPool::CHUNK_SIZE[0]
+                                                              : ChunkPool::CHUNK_SIZE[ChunkPool::CLASS_NUM - 1]);
+        iov[0].iov_base = fresh->Data();
+        iov[0].iov_len = fresh->cap;
+    }
+    iov[1].iov_base = extra;
+    iov[1].iov_len = sizeof(extra);
+
+    const ssize_t len = readv(fd, iov, 2);
+    if(len < 0) {
+        *saveErrno = errno;
+    }
+    size_t left = len > 0 ? static_cast<size_t>(len) : 0;
+    size_t n = std::min(left, iov[0].iov_len);
+    if(fresh) {
+        /* 读到数据的新块接入链尾，否则立即归还 */
+        if(n > 0) {
+            slices_.push_back({fresh, 0, n});
+        } else {
+            ChunkPool::Instance()->Release(fresh);
+        }
+    } else {
+        slices_.back().write += n;
+    }
+    readable_ += n;
+    if(left > n) {
+        Append(extra, left - n);
+    }
+    return len;
+}
+
+int ChainBuffer::FillIovec(struct iovec* iov, int maxCnt) const {
+    int cnt = 0;
+    for(size_t i = 0; i < slices_.size() && cnt < maxCnt; i++) {
+        const Slice& s = slices_[i];
+        iov[cnt].iov_base = s.chunk->Data() + s.read;
+        iov[cnt].iov_len = s.write - s.read;
+        cnt++;
+    }
+    return cnt;
+}
+
+ssize_t ChainBuffer::WriteFd(int fd, int* saveErrno) {
+    if(readable_ == 0) {
+        return 0;
+    }
+    struct iovec iov[MAX_IOV];
+    int cnt = FillIovec(iov, MAX_IOV);
+    ssize_t len = writev(fd, iov, cnt);
+    if(len < 0) {
+        *saveErrno = errno;
+        return len;
+    }
+    Retrieve(len);
+    return len;
+}
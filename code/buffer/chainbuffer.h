@@ -0,0 +1,67 @@
+#ifndef CHAIN_BUFFER_H
+#define CHAIN_BUFFER_H
+#include <deque>
+#include <string>
+#include <unistd.h>  // write
+#include <sys/uio.h> // readv/writev
+#include <assert.h>
+#include "chunkpool.h"
+
+/*
+ * 由定长块串成的缓冲区
+ * 块来自全局 ChunkPool，写满一块就接上新的一块，不会整体扩容搬移；
+ * 读空的块立即归还，只有最后一块留下重置下标，下一次追加或读取直接写入其中，不进池；
+ * 连接空闲或关闭时 Shrink 归还这最后一块，空闲的长连接不占用缓冲内存
+ * ReadFd 用 readv 直接读入新块，写出时 FillIovec 把所有块交给一次 writev
+ *
+ * Peek()/BeginWriteConst() 只覆盖第一块中的连续数据，
+ * 解析器在其中找不到完整的行时调用 PullupNext() 把后一块并入第一块，合并后的第一块不超过64KB
+ */
+class ChainBuffer {
+public:
+    ChainBuffer();
+    ~ChainBuffer();
+
+    ChainBuffer(const ChainBuffer&) = delete;
+    ChainBuffer& operator=(const ChainBuffer&) = delete;
+
+    size_t ReadableBytes() const { return readable_; }  //返回所有块中可读的字节数
+    size_t ChunkCount() const { return slices_.size(); }
+
+    const char* Peek() const;           //第一块中可读数据的起始位置
+    const char* BeginWriteConst() const;//第一块中可读数据的末尾（连续区域的末尾）
+    bool PullupNext();                  //把第二块的数据（放不下时只取前一部分）并入第一块，没有第二块或第一块已满64KB时返回false
+
+    void Retrieve(size_t len);          //取走 len 个字节，读空的块归还到池中（最后一块保留）
+    void RetrieveUntil(const char* end);//取走直到 end（end 必须在第一块内）
+    void RetrieveAll();                 //清空，只保留最后一块
+    void Shrink();                      //缓冲区为空时把保留的块也还给池
+    std::string RetrieveToStr(size_t len);  //取走 len 个字节并返回字符串
+    std::string RetrieveAllToStr();
+
+    void Append(const std::string& str);
+    void Append(const char* str, size_t len);
+    void Append(const void* data, size_t len);
+
+    ssize_t ReadFd(int fd, int* Errno);     // 用 readv 把数据直接读入块中，超出的部分经栈上缓冲追加
+    ssize_t WriteFd(int fd, int* Errno);    // 用 writev 写出所有块
+
+    int FillIovec(struct iovec* iov, int maxCnt) const;    // 依次填入各块的可读区域，返回使用的个数
+
+private:
+    struct Slice {
+        ChunkPool::Chunk* chunk;
+        size_t read;        // 块内读位置
+        size_t write;       // 块内写位置
+    };
+
+    static const int MAX_IOV = 16;
+
+    void PopFront_();
+    void ReleaseAll_();
+
+    std::deque<Slice> slices_;
+    size_t readable_;
+};
+
+#endif //CHAIN_BUFFER_H
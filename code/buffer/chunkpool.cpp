@@ -0,0 +1,84 @@
+#include "chunkpool.h"
+#include <stdlib.h>
+#include <new>
+
+const size_t ChunkPool::CHUNK_SIZE[CLASS_NUM] = { 4096, 16384, 65536 };
+
+ChunkPool::ChunkPool() : cachedBytes_(0), inUseBytes_(0), maxCachedBytes_(32 << 20) {
+    for(int i = 0; i < CLASS_NUM; i++) {
+        lists_[i].head = nullptr;
+    }
+}
+
+ChunkPool::~ChunkPool() {
+    for(int i = 0; i < CLASS_NUM; i++) {
+        Chunk* c = lists_[i].head;
+        while(c) {
+            Chunk* next = c->next;
+            free(c);
+            c = next;
+        }
+        lists_[i].head = nullptr;
+    }
+}
+
+ChunkPool* ChunkPool::Instance() {
+    static ChunkPool pool;
+    return &pool;
+}
+
+int ChunkPool::ClassOf_(size_t size) {
+    for(int i = 0; i < CLASS_NUM; i++) {
+        if(size <= CHUNK_SIZE[i]) {
+            return i;
+        }
+    }
+    return CLASS_NUM;
+}
+
+ChunkPool::Chunk* ChunkPool::Acquire(size_t size) {
+    int cls = ClassOf_(size);
+    size_t cap = (cls < CLASS_NUM) ? CHUNK_SIZE[cls] : size;
+    Chunk* chunk = nullptr;
+    if(cls < CLASS_NUM) {
+        FreeList& list = lists_[cls];
+        std::lock_guard<std::mutex> locker(list.mtx);
+        chunk = list.head;
+        if(chunk) {
+            list.head = chunk->next;
+            cachedBytes_.fetch_sub(cap, std::memory_order_relaxed);
+        }
+    }
+    if(!chunk) {
+        void* mem = malloc(sizeof(Chunk) + cap);
+        if(!mem) {
+            throw std::bad_alloc();
+        }
+        chunk = static_cast<Chunk*>(mem);
+        chunk->cap = cap;
+        chunk->cls = cls;
+    }
+    chunk->next = nullptr;
+    inUseBytes_.fetch_add(cap, std::memory_order_relaxed);
+    return chunk;
+}
+
+void ChunkPool::Release(Chunk* chunk) {
+    if(!chunk) { return; }
+    inUseBytes_.fetch_sub(chunk->cap, std::memory_order_relaxed);
+    if(chunk->cls < CLASS_NUM &&
+       cachedBytes_.load(std::memory_order_relaxed) + chunk->cap <=
+       maxCachedBytes_.load(std::memory_order_relaxed)) {
+        FreeList& list = lists_[chunk->cls];
+        std::lock_guard<std::mutex> locker(list.mtx);
+        chunk->next = list.head;
+        list.head = chunk;
+        cachedBytes_.fetch_add(chunk->cap, std::memory_order_relaxed);
+        return;
+    }
+    free(chunk);
+}
+
+void ChunkPool::SetMaxCachedBytes(size_t bytes) {
+    maxCachedBytes_.store(bytes, std::memory_order_relaxed);
+}
@@ -0,0 +1,51 @@
+#ifndef CHUNK_POOL_H
+#define CHUNK_POOL_H
+#include <mutex>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 全局的定长内存块池，供 Buffer 和 ChainBuffer 使用
+ * 按 4KB/16KB/64KB 三个尺寸分类，每类一条空闲链表；块归还后优先留在链表中复用，
+ * 空闲总量超过上限时直接释放给系统。超过64KB的请求单独分配，不进入缓存
+ */
+class ChunkPool {
+public:
+    static const int CLASS_NUM = 3;
+    static const size_t CHUNK_SIZE[CLASS_NUM];     // 各尺寸类的数据容量
+
+    struct Chunk {
+        Chunk* next;        // 空闲链表指针
+        size_t cap;         // 数据区容量
+        int cls;            // 尺寸类下标，CLASS_NUM表示单独分配的大块
+        char* Data() { return reinterpret_cast<char*>(this + 1); }
+    };
+
+    static ChunkPool* Instance();
+
+    Chunk* Acquire(size_t size);        // 取一块容量不小于size的块（size不超过64KB时取对应尺寸类）
+    void Release(Chunk* chunk);         // 归还，空闲总量超限时释放给系统
+
+    void SetMaxCachedBytes(size_t bytes);
+    size_t CachedBytes() const { return cachedBytes_.load(std::memory_order_relaxed); }
+    size_t InUseBytes() const { return inUseBytes_.load(std::memory_order_relaxed); }
+
+private:
+    ChunkPool();
+    ~ChunkPool();
+
+    static int ClassOf_(size_t size);
+
+    struct alignas(64) FreeList {
+        std::mutex mtx;
+        Chunk* head;
+    };
+
+    FreeList lists_[CLASS_NUM];
+    std::atomic<size_t> cachedBytes_;   // 空闲链表中的字节数
+    std::atomic<size_t> inUseBytes_;    // 已借出的字节数
+    std::atomic<size_t> maxCachedBytes_;
+};
+
+#endif //CHUNK_POOL_H
@@ -0,0 +1,211 @@
+#include "ringbuffer.h"
+#include <sys/mman.h>
+#include <errno.h>
+#include <string.h>
+#include <new>
+#include <algorithm>
+
+const size_t RingBuffer::MIN_CAPACITY;
+
+RingBuffer::RingBuffer() : base_(nullptr), cap_(0), readPos_(0), writePos_(0) {}
+
+RingBuffer::~RingBuffer() {
+    Unmap_(base_, cap_);
+}
+
+size_t RingBuffer::ReadableBytes() const {
+    return writePos_ - readPos_;
+}
+
+size_t RingBuffer::WritableBytes() const {
+    return cap_ - ReadableBytes();
+}
+
+const char* RingBuffer::Peek() const {
+    return base_ + (readPos_ & (cap_ - 1));
+}
+
+const char* RingBuffer::BeginWriteConst() const {
+    return base_ + (writePos_ & (cap_ - 1));
+}
+
+char* RingBuffer::BeginWrite() {
+    return base_ + (writePos_ & (cap_ - 1));
+}
+
+void RingBuffer::HasWritten(size_t len) {
+    assert(len <= WritableBytes());
+    writePos_ += len;
+}
+
+void RingBuffer::Retrieve(size_t len) {
+    assert(len <= ReadableBytes());
+    readPos_ += len;
+    if(readPos_ == writePos_) {
+        /* 读空后回到起点，下次写入从映射开头开始 */
+        readPos_ = writePos_ = 0;
+    }
+}
+
+void RingBuffer::RetrieveUntil(const char* end) {
+    assert(Peek() <= end);
+    Retrieve(end - Peek());
+}
+
+void RingBuffer::RetrieveAll() {
+    readPos_ = 0;
+    writePos_ = 0;
+}
+
+void RingBuffer::Shrink() {
+    /* 空闲的环不论大小都解除映射：环的页面只在有数据时有用，重新映射的代价只在下次读入时付一次 */
+    if(ReadableBytes() != 0 || !base_) {
+        return;
+    }
+    Unmap_(base_, cap_);
+    base_ = nullptr;
+    cap_ = 0;
+    readPos_ = 0;
+    writePos_ = 0;
+}
+
+std::string RingBuffer::RetrieveAllToStr() {
+    if(ReadableBytes() == 0) {
+        return std::string();
+    }
+    std::string str(Peek(), ReadableBytes());
+    RetrieveAll();
+    return str;
+}
+
+void RingBuffer::Append(const std::string& str) {
+    Append(str.data(), str.length());
+}
+
+void RingBuffer::Append(const void* data, size_t len) {
+    assert(data);
+    Append(static_cast<const char*>(data), len);
+}
+
+void RingBuffer::Append(const char* str, size_t len) {
+    assert(str);
+    EnsureWriteable(len);
+    memcpy(BeginWrite(), str, len);
+    HasWritten(len);
+}
+
+void RingBuffer::EnsureWriteable(size_t len) {
+    if(WritableBytes() < len && !Grow_(len)) {
+        throw std::bad_alloc();
+    }
+    assert(WritableBytes() >= len);
+}
+
+ssize_t RingBuffer::ReadFd(int fd, int* saveErrno) {
+    static thread_local char buff[65536];
+    /* 在事件循环中读取：映射失败（memfd/mmap数量或内存耗尽）只让这个连接出错，不抛异常 */
+    if(cap_ == 0 && !Grow_(0)) {
+        *saveErrno = ENOMEM;
+        return -1;
+    }
+    struct iovec iov[2];
+    const size_t writable = WritableBytes();
+    /* 镜像映射保证写区域连续，溢出部分先读到线程局部缓冲区再追加（溢出后环按2的幂扩容，下次直接读入） */
+    iov[0].iov_base = BeginWrite();
+    iov[0].iov_len = writable;
+    iov[1].iov_base = buff;
+    iov[1].iov_len = sizeof(buff);
+
+    const ssize_t len = readv(fd, iov, 2);
+    if(len < 0) {
+        *saveErrno = errno;
+    }
+    else if(static_cast<size_t>(len) <= writable) {
+        writePos_ += len;
+    }
+    else {
+        writePos_ += writable;
+        size_t extra = len - writable;
+        if(!Grow_(extra)) {
+            /* 溢出的数据放不下，已从套接字取走，连接只能关闭 */
+            *saveErrno = ENOMEM;
+            return -1;
+        }
+        memcpy(BeginWrite(), buff, extra);
+        HasWritten(extra);
+    }
+    return len;
+}
+
+ssize_t RingBuffer::WriteFd(int fd, int* saveErrno) {
+    if(ReadableBytes() == 0) {
+        return 0;
+    }
+    ssize_t len = write(fd, Peek(), ReadableBytes());
+    if(len < 0) {
+        *saveErrno = errno;
+        return len;
+    }
+    Retrieve(len);
+    return len;
+}
+
+char* RingBuffer::Map_(size_t cap) {
+    int fd = memfd_create("ringbuffer", MFD_CLOEXEC);
+    if(fd < 0) {
+        return nullptr;
+    }
+    if(ftruncate(fd, cap) < 0) {
+        close(fd);
+        return nullptr;
+    }
+    /* 先占住 2*cap 的地址空间，再把同一个文件固定映射到前后两半 */
+    void* area = mmap(nullptr, cap * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(area == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+    }
+    char* base = static_cast<char*>(area);
+    void* first = mmap(base, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    void* second = mmap(base + cap, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    /* 映射会持有文件引用，描述符可以立即关闭，不占用连接的fd配额 */
+    close(fd);
+    if(first == MAP_FAILED || second == MAP_FAILED) {
+        munmap(base, cap * 2);
+        return nullptr;
+    }
+    return base;
+}
+
+void RingBuffer::Unmap_(char* base, size_t cap) {
+    if(base) {
+        munmap(base, cap * 2);
+    }
+}
+
+bool RingBuffer::Grow_(size_t len) {
+    size_t need = ReadableBytes() + len;
+    /* 容量必须是页大小的整数倍，第二段映射才能对齐 */
+    static const size_t minCap = std::max<size_t>(MIN_CAPACITY, sysconf(_SC_PAGESIZE));
+    size_t cap = cap_ ? cap_ : minCap;
+    while(cap < need) {
+        cap <<= 1;
+    }
+    if(cap == cap_) {
+        return true;
+    }
+    char* base = Map_(cap);
+    if(!base) {
+        return false;
+    }
+    size_t readable = ReadableBytes();
+    if(readable) {
+        memcpy(base, Peek(), readable);
+    }
+    Unmap_(base_, cap_);
+    base_ = base;
+    cap_ = cap;
+    readPos_ = 0;
+    writePos_ = readable;
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+#include <string>
+#include <unistd.h>  // read
+#include <sys/uio.h> // readv
+#include <stdint.h>
+#include <assert.h>
+
+/*
+ * 环形缓冲区（"magic ring"）
+ * 同一块共享内存被连续映射两次，[base, base+cap) 与 [base+cap, base+2cap) 指向相同的物理页，
+ * 因此从任意位置开始的 cap 字节都是连续可访问的：Peek()/BeginWrite() 总能返回连续内存，
+ * 取走数据只移动下标，不需要像 Buffer 那样把未读数据搬到头部，也不做清零
+ * 接口与 Buffer 保持一致，可直接用于 HttpRequest::parse
+ */
+class RingBuffer {
+public:
+    RingBuffer();                       // 不立即分配，首次写入时才映射
+    ~RingBuffer();
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    size_t WritableBytes() const;       //返回可写入的字节数
+    size_t ReadableBytes() const;       //返回可读的字节数
+    size_t Capacity() const { return cap_; }
+
+    const char* Peek() const;           //返回缓冲区当前读取位置的指针
+    void EnsureWriteable(size_t len);   //确保有len字节的连续可写空间，不足时按2的幂扩容，映射失败时抛出 std::bad_alloc
+    void HasWritten(size_t len);        //标记len字节已被写入
+
+    void Retrieve(size_t len);          //读取 len 个字节并移动读取位置
+    void RetrieveUntil(const char* end);//读取直到遇到 end 指针所指的位置
+
+    void RetrieveAll();                 //清空缓冲区（只重置下标）
+    std::string RetrieveAllToStr();     //读取整个缓冲区并返回一个字符串
+
+    const char* BeginWriteConst() const;//返回缓冲区当前写入位置的指针
+    char* BeginWrite();                 //返回缓冲区当前写入位置的指针
+
+    void Append(const std::string& str);
+    void Append(const char* str, size_t len);
+    void Append(const void* data, size_t len);
+
+    ssize_t ReadFd(int fd, int* Errno);     // 从文件描述符 fd 读取数据到缓冲区，映射失败时返回-1、Errno为ENOMEM
+    ssize_t WriteFd(int fd, int* Errno);    // 将可读数据写入文件描述符 fd
+
+    void Shrink();                          // 缓冲区为空时解除映射，下次读写时重新映射
+
+private:
+    static const size_t MIN_CAPACITY = 4096;
+
+    static char* Map_(size_t cap);          // 建立双重映射，失败时返回nullptr
+    static void Unmap_(char* base, size_t cap);
+    bool Grow_(size_t len);                 // 换一块更大的环，只在扩容时拷贝一次未读数据；映射失败时返回false，原有数据不变
+
+    char* base_;            // 双重映射的起始地址
+    size_t cap_;            // 环的容量（2的幂，页对齐）
+    uint64_t readPos_;      // 单调递增的读下标，对cap_取模得到偏移
+    uint64_t writePos_;     // 单调递增的写下标
+};
+
+#endif //RING_BUFFER_H
@@ -38,17 +38,28 @@ int main() {
     // 测试 Peek 函数
     buffer.Append("Hello, ");
     buffer.Append("World!");
-    std::cout << "Peek: " << buffer.Peek() << std::endl;
+    std::cout << "Peek: " << std::string(buffer.Peek(), buffer.ReadableBytes()) << std::endl;
 
     // 测试 BeginWrite 函数
     buffer.Append("Hello, ");
     buffer.Append("World!");
-    std::cout << "BeginWrite: " << buffer.BeginWrite() << std::endl;
+    std::cout << "BeginWrite: Peek + " << (buffer.BeginWrite() - buffer.Peek()) << std::endl;
 
     // 测试 BeginWriteConst 函数
     buffer.Append("Hello, ");
     buffer.Append("World!");
-    std::cout << "BeginWriteConst: " << buffer.BeginWriteConst() << std::endl;
+    std::cout << "BeginWriteConst: Peek + " << (buffer.BeginWriteConst() - buffer.Peek()) << std::endl;
+
+    // 测试 Shrink 函数：保留未读数据，释放多余容量
+    buffer.Append(std::string(8192, 'x'));
+    buffer.RetrieveAll();
+    buffer.Append("tail");
+    buffer.Shrink(0);
+    std::cout << "Shrink: capacity " << buffer.Capacity() << ", data " << buffer.RetrieveAllToStr() << std::endl;
+    buffer.Shrink(0);
+    std::cout << "Shrink empty: capacity " << buffer.Capacity() << std::endl;
+    buffer.Append("Hello again");
+    std::cout << "Append after shrink: " << buffer.RetrieveAllToStr() << std::endl;
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "chainbuffer.h"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <fcntl.h>
+
+int main() {
+    ChunkPool* pool = ChunkPool::Instance();
+    {
+        ChainBuffer chain;
+
+        // 测试 Append/RetrieveAllToStr
+        chain.Append("Hello, ");
+        chain.Append("World!");
+        assert(chain.ChunkCount() == 1);
+        assert(chain.RetrieveAllToStr() == "Hello, World!");
+        assert(chain.ChunkCount() == 1);     // 读空后保留最后一块，下次追加不进池
+        chain.Append("again");
+        assert(chain.ChunkCount() == 1);
+        chain.RetrieveAll();
+        chain.Shrink();
+        assert(chain.ChunkCount() == 0);
+        assert(pool->InUseBytes() == 0);
+
+        // 测试跨块追加：超过64KB的数据被切成多块
+        std::string big(70000, 'b');
+        chain.Append(big);
+        std::cout << "Append 70000 bytes -> chunks: " << chain.ChunkCount() << std::endl;
+        assert(chain.ChunkCount() == 2);
+        assert(chain.ReadableBytes() == big.size());
+
+        // 测试跨块取走，读空的块立即归还
+        chain.Retrieve(65536);
+        assert(chain.ChunkCount() == 1);
+        assert(chain.RetrieveToStr(100) == std::string(100, 'b'));
+        chain.RetrieveAll();
+        chain.Shrink();
+        assert(pool->InUseBytes() == 0);
+
+        // 测试 PullupNext：跨块的行合并后可连续查找
+        chain.Append(std::string(4095, 'h'));
+        chain.Append("\r\nTail\r\n");
+        assert(chain.ChunkCount() == 2);
+        assert(memchr(chain.Peek(), '\n', chain.BeginWriteConst() - chain.Peek()) == nullptr);
+        assert(chain.PullupNext());
+        assert(chain.ChunkCount() == 1);
+        assert(chain.ReadableBytes() == 4103);
+        assert(memcmp(chain.BeginWriteConst() - 8, "\r\nTail\r\n", 8) == 0);
+        assert(!chain.PullupNext());
+        chain.RetrieveAll();
+
+        // 测试 PullupNext 的上限：合并后的第一块不超过64KB，放不下的部分留在第二块
+        chain.Append(std::string(65536, 'x'));
+        chain.Append(std::string(65536, 'y'));
+        chain.Retrieve(65000);
+        assert(chain.PullupNext());
+        assert(chain.ChunkCount() == 2);
+        assert(static_cast<size_t>(chain.BeginWriteConst() - chain.Peek()) == 65536);
+        assert(!chain.PullupNext());
+        assert(chain.ReadableBytes() == 65536 + 536);
+        chain.RetrieveAll();
+        assert(chain.ChunkCount() == 1);
+        chain.Shrink();
+        assert(pool->InUseBytes() == 0);
+
+        // 测试 ReadFd/WriteFd
+        int fds[2];
+        assert(pipe(fds) == 0);
+        fcntl(fds[0], F_SETPIPE_SZ, 1 << 20);
+        std::string data(100000, 'r');
+        assert(write(fds[1], data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+        int err = 0;
+        ssize_t n = 0;
+        while(chain.ReadableBytes() < data.size()) {
+            n = chain.ReadFd(fds[0], &err);
+            assert(n > 0);
+        }
+        std::cout << "ReadFd 100000 bytes -> chunks: " << chain.ChunkCount() << std::endl;
+        while(chain.ReadableBytes() > 0) {
+            assert(chain.WriteFd(fds[1], &err) > 0);
+        }
+        std::string back(data.size(), '\0');
+        size_t got = 0;
+        while(got < back.size()) {
+            n = read(fds[0], &back[got], back.size() - got);
+            assert(n > 0);
+            got += n;
+        }
+        assert(back == data);
+        close(fds[0]);
+        close(fds[1]);
+    }
+    std::cout << "in use: " << pool->InUseBytes() << ", cached: " << pool->CachedBytes() << std::endl;
+    assert(pool->InUseBytes() == 0);
+    std::cout << "ChainBuffer tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "ringbuffer.h"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/resource.h>
+
+/* 有副作用的调用都先存到变量再断言，定义NDEBUG编译时也会执行 */
+int main() {
+    RingBuffer ring;
+    assert(ring.Capacity() == 0);
+    assert(ring.ReadableBytes() == 0);
+
+    // 测试 Append/RetrieveAllToStr
+    ring.Append("Hello, ");
+    ring.Append("World!");
+    std::cout << "Capacity: " << ring.Capacity() << std::endl;
+    std::string str = ring.RetrieveAllToStr();
+    assert(str == "Hello, World!");
+
+    // 测试跨越环尾的数据仍然连续可读
+    size_t cap = ring.Capacity();
+    std::string head(cap - 10, 'a');
+    ring.Append(head);
+    ring.Retrieve(head.size() - 5);      // 只剩5字节，读位置在环尾附近
+    ring.Append("0123456789ABCDEF");     // 写入越过环尾
+    assert(ring.Capacity() == cap);      // 容量足够时不扩容、不搬移
+    assert(ring.ReadableBytes() == 21);
+    assert(memcmp(ring.Peek(), "aaaaa0123456789ABCDEF", 21) == 0);
+    std::cout << "Wrap: " << std::string(ring.Peek(), ring.ReadableBytes()) << std::endl;
+
+    // 测试 RetrieveUntil
+    const char* pos = static_cast<const char*>(memchr(ring.Peek(), '9', ring.ReadableBytes()));
+    ring.RetrieveUntil(pos);
+    str = ring.RetrieveAllToStr();
+    assert(str == "9ABCDEF");
+
+    // 测试扩容后数据保持不变
+    std::string big(cap * 3 + 123, 'b');
+    ring.Append("xyz");
+    ring.Append(big);
+    assert(ring.Capacity() >= big.size() + 3);
+    assert(ring.ReadableBytes() == big.size() + 3);
+    assert(memcmp(ring.Peek(), "xyzbbb", 6) == 0);
+    std::cout << "Grow: capacity " << cap << " -> " << ring.Capacity() << std::endl;
+    ring.RetrieveAll();
+
+    // 测试 ReadFd/WriteFd
+    int fds[2];
+    int ret = pipe(fds);
+    assert(ret == 0);
+    const char* msg = "GET / HTTP/1.1\r\n\r\n";
+    const ssize_t msgLen = strlen(msg);
+    ssize_t n = write(fds[1], msg, msgLen);
+    assert(n == msgLen);
+    int err = 0;
+    n = ring.ReadFd(fds[0], &err);
+    assert(n == msgLen);
+    n = ring.WriteFd(fds[1], &err);
+    assert(n == msgLen);
+    assert(ring.ReadableBytes() == 0);
+    char out[64] = {0};
+    n = read(fds[0], out, sizeof(out));
+    assert(n == msgLen);
+    assert(strcmp(out, msg) == 0);
+
+    // 测试 Shrink：空闲时不论容量大小都解除映射，再次写入时重新映射
+    ring.Shrink();
+    assert(ring.Capacity() == 0);
+    ring.Append("again");
+    assert(ring.Capacity() > 0);
+    str = ring.RetrieveAllToStr();
+    assert(str == "again");
+    ring.Shrink();
+    assert(ring.Capacity() == 0);
+
+    // 测试映射失败：描述符用尽时 memfd_create 失败，ReadFd 返回-1并报告ENOMEM，不抛异常
+    n = write(fds[1], msg, msgLen);
+    assert(n == msgLen);
+    struct rlimit old;
+    ret = getrlimit(RLIMIT_NOFILE, &old);
+    assert(ret == 0);
+    struct rlimit low = old;
+    low.rlim_cur = fds[1] + 1;
+    ret = setrlimit(RLIMIT_NOFILE, &low);
+    assert(ret == 0);
+    RingBuffer failing;
+    err = 0;
+    n = failing.ReadFd(fds[0], &err);
+    ret = setrlimit(RLIMIT_NOFILE, &old);
+    assert(ret == 0);
+    assert(n == -1 && err == ENOMEM);
+    assert(failing.Capacity() == 0);
+    (void)ret;
+    (void)n;
+    close(fds[0]);
+    close(fds[1]);
+
+    std::cout << "RingBuffer tests passed" << std::endl;
+    return 0;
+}
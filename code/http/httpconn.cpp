@@ -1,41 +1,94 @@
 #include "httpconn.h"
+#include <algorithm>
+#include <string.h>
 using namespace std;
 
 const char* HttpConn::srcDir;
 std::atomic<int> HttpConn::userCount;
 bool HttpConn::isET;
+const char* HttpConn::metricsPath = "";
+bool HttpConn::metricsOnAdmin = false;
+int HttpConn::slowRequestMs = 0;
+int HttpConn::bufferMode = HttpConn::BUFFER_VECTOR;
+int HttpConn::idleBufferKB = -1;
+/* 一个最大的请求（请求头加请求体）再留一块余量给流水线上的后续请求 */
+const size_t HttpConn::MAX_READ_BYTES = HttpRequest::MAX_HEADER_BYTES + HttpRequest::MAX_BODY + 65536;
+
+/* 两个时间点之间的微秒数 */
+static uint64_t ElapsedUs(std::chrono::steady_clock::time_point from,
+                          std::chrono::steady_clock::time_point to) {
+    if(to <= from) { return 0; }
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
 
 HttpConn::HttpConn() { 
     fd_ = -1;
     addr_ = { 0 };
     isClose_ = true;
+    isAdmin_ = false;
+    state_ = 0;
+    wantWrite_ = false;
+    registered_ = false;
+    generation_ = 0;
+    trace_ = Trace();
 };
 
 HttpConn::~HttpConn() { 
     Close(); 
 };
 
-void HttpConn::init(int fd, const sockaddr_in& addr) {
+void HttpConn::init(int fd, const sockaddr_in& addr, bool isAdmin) {
     assert(fd > 0);
     userCount++;
     addr_ = addr;
     fd_ = fd;
+    isAdmin_ = isAdmin;
+    state_ = 0;
+    wantWrite_ = false;
+    registered_ = false;
+    trace_ = Trace();
+    trace_.accept = TraceClock::now();
+    trace_.firstOnConn = true;
+    iov_[0].iov_len = iov_[1].iov_len = 0;
+    iovCnt_ = 0;
     writeBuff_.RetrieveAll();
     readBuff_.RetrieveAll();
+    readRing_.RetrieveAll();
+    readChain_.RetrieveAll();
+    writeChain_.RetrieveAll();
+    request_.Init();
     isClose_ = false;
+    ReleaseIdle();      /* 上一个连接留下的缓冲区按空闲策略处理 */
     LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
 }
 
 void HttpConn::Close() {
     response_.UnmapFile();
+    /* 未读完/未写完的块连同保留的最后一块还给池 */
+    readChain_.RetrieveAll();
+    readChain_.Shrink();
+    writeChain_.RetrieveAll();
+    writeChain_.Shrink();
     if(isClose_ == false){
         isClose_ = true; 
+        generation_.fetch_add(1, std::memory_order_release);
         userCount--;
+        registered_ = false;
         close(fd_);
         LOG_INFO("Client[%d](%s:%d) quit, UserCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
     }
 }
 
+bool HttpConn::DeferIfOffloaded(int flags) {
+    int state = state_.load(std::memory_order_acquire);
+    while(state & OFFLOADED) {
+        if(state_.compare_exchange_weak(state, state | flags, std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 int HttpConn::GetFd() const {
     return fd_;
 };
@@ -54,58 +107,283 @@ int HttpConn::GetPort() const {
 
 ssize_t HttpConn::read(int* saveErrno) {
     ssize_t len = -1;
+    uint64_t total = 0;
     do {
-        len = readBuff_.ReadFd(fd_, saveErrno);
+        if(bufferMode == BUFFER_RING) {
+            len = readRing_.ReadFd(fd_, saveErrno);
+        } else if(bufferMode == BUFFER_CHAIN) {
+            len = readChain_.ReadFd(fd_, saveErrno);
+        } else {
+            len = readBuff_.ReadFd(fd_, saveErrno);
+        }
         if (len <= 0) {
             break;
         }
+        total += len;
+        if(ReadableBytes_() > MAX_READ_BYTES) {
+            /* 对端发送的数据远超解析上限，不再读入，由调用方关闭连接 */
+            LOG_WARN("Client[%d] read buffer over %zu bytes, closing", fd_, MAX_READ_BYTES);
+            *saveErrno = EMSGSIZE;
+            len = -1;
+            break;
+        }
     } while (isET);
+    if(total > 0) {
+        if(!trace_.started) {
+            trace_.firstRead = TraceClock::now();
+            trace_.started = true;
+        }
+        Metrics::Instance()->Add(Metrics::BYTES_IN, total);
+    }
     return len;
 }
 
+void HttpConn::ReleaseIdle() {
+    if(idleBufferKB < 0 || isClose_) {
+        return;
+    }
+    /* 只在两个请求之间释放：读缓冲区为空、请求还没开始解析、响应已写完 */
+    if(ReadableBytes_() != 0 || !request_.IsIdle() || ToWriteBytes() != 0) {
+        return;
+    }
+    size_t keep = static_cast<size_t>(idleBufferKB) * 1024;
+    readBuff_.Shrink(keep);
+    writeBuff_.Shrink(keep);
+    readRing_.Shrink();     /* 环为空即解除映射，不按keep保留 */
+    readChain_.Shrink();    /* 块链只剩保留的最后一块，同样整块归还 */
+    writeChain_.Shrink();
+    request_.Shrink();
+    response_.UnmapFile();
+}
+
+void HttpConn::MarkQueued() {
+    trace_.queued = TraceClock::now();
+}
+
+void HttpConn::MarkDequeued() {
+    trace_.queueUs += ElapsedUs(trace_.queued, TraceClock::now());
+}
+
 ssize_t HttpConn::write(int* saveErrno) {
+    ssize_t len = -1;
+    uint64_t total = 0;
+    if(bufferMode == BUFFER_CHAIN) {
+        len = WriteChain_(saveErrno, total);
+    } else {
+        do {
+            len = writev(fd_, iov_, iovCnt_);
+            if(len <= 0) {
+                *saveErrno = errno;
+                break;
+            }
+            total += len;
+            if(iov_[0].iov_len + iov_[1].iov_len  == 0) { break; } /* 传输结束 */
+            else if(static_cast<size_t>(len) > iov_[0].iov_len) {
+                iov_[1].iov_base = (uint8_t*) iov_[1].iov_base + (len - iov_[0].iov_len);
+                iov_[1].iov_len -= (len - iov_[0].iov_len);
+                if(iov_[0].iov_len) {
+                    writeBuff_.RetrieveAll();
+                    iov_[0].iov_len = 0;
+                }
+            }
+            else {
+                iov_[0].iov_base = (uint8_t*)iov_[0].iov_base + len; 
+                iov_[0].iov_len -= len; 
+                writeBuff_.Retrieve(len);
+            }
+        } while(isET || ToWriteBytes() > 10240);
+    }
+    if(total > 0) {
+        Metrics::Instance()->Add(Metrics::BYTES_OUT, total);
+    }
+    if(ToWriteBytes() == 0 && trace_.started) {
+        FinishTrace_();
+    }
+    return len;
+}
+
+ssize_t HttpConn::WriteChain_(int* saveErrno, uint64_t& total) {
+    /* 每轮按剩余数据重新收集iovec：响应头所在的各块在前，文件在后。
+       块数超过上限时本轮只写块，文件留到块写完之后，保证顺序 */
+    static const int MAX_IOV = 16;
+    struct iovec iov[MAX_IOV];
     ssize_t len = -1;
     do {
-        len = writev(fd_, iov_, iovCnt_);
+        int cnt = writeChain_.FillIovec(iov, MAX_IOV - 1);
+        if(static_cast<size_t>(cnt) == writeChain_.ChunkCount() && iov_[1].iov_len > 0) {
+            iov[cnt++] = iov_[1];
+        }
+        len = writev(fd_, iov, cnt);
         if(len <= 0) {
             *saveErrno = errno;
             break;
         }
-        if(iov_[0].iov_len + iov_[1].iov_len  == 0) { break; } /* 传输结束 */
-        else if(static_cast<size_t>(len) > iov_[0].iov_len) {
-            iov_[1].iov_base = (uint8_t*) iov_[1].iov_base + (len - iov_[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
-            if(iov_[0].iov_len) {
-                writeBuff_.RetrieveAll();
-                iov_[0].iov_len = 0;
-            }
-        }
-        else {
-            iov_[0].iov_base = (uint8_t*)iov_[0].iov_base + len; 
-            iov_[0].iov_len -= len; 
-            writeBuff_.Retrieve(len);
-        }
+        total += len;
+        size_t fromChain = std::min(static_cast<size_t>(len), writeChain_.ReadableBytes());
+        writeChain_.Retrieve(fromChain);
+        size_t fromFile = len - fromChain;
+        iov_[1].iov_base = (uint8_t*)iov_[1].iov_base + fromFile;
+        iov_[1].iov_len -= fromFile;
+        if(ToWriteBytes() == 0) { break; } /* 传输结束 */
     } while(isET || ToWriteBytes() > 10240);
     return len;
 }
 
-bool HttpConn::process() {
-    request_.Init();
-    if(readBuff_.ReadableBytes() <= 0) {
+void HttpConn::FinishTrace_() {
+    TraceClock::time_point done = TraceClock::now();
+    uint64_t total = ElapsedUs(trace_.firstRead, done);
+    uint64_t acceptToRead = ElapsedUs(trace_.accept, trace_.firstRead);
+    uint64_t readToParse = ElapsedUs(trace_.firstRead, trace_.parsed);
+    uint64_t parseToBuild = ElapsedUs(trace_.parsed, trace_.built);
+    uint64_t buildToWrite = ElapsedUs(trace_.built, done);
+
+    Metrics* metrics = Metrics::Instance();
+    metrics->Observe(Metrics::REQUEST_LATENCY, total);
+    if(trace_.firstOnConn) {
+        metrics->Observe(Metrics::STAGE_ACCEPT_TO_READ, acceptToRead);
+    }
+    metrics->Observe(Metrics::STAGE_READ_TO_PARSE, readToParse);
+    metrics->Observe(Metrics::STAGE_PARSE_TO_BUILD, parseToBuild);
+    metrics->Observe(Metrics::STAGE_BUILD_TO_WRITE, buildToWrite);
+    metrics->Observe(Metrics::STAGE_QUEUE_WAIT, trace_.queueUs);
+
+    if(slowRequestMs > 0 && total >= static_cast<uint64_t>(slowRequestMs) * 1000) {
+        LOG_WARN("Slow request Client[%d] %s %s code:%d total:%lluus accept->read:%lluus "
+                 "read->parse:%lluus parse->build:%lluus build->write:%lluus queue:%lluus",
+                 fd_, request_.method().c_str(), request_.path().c_str(), response_.Code(),
+                 (unsigned long long)total,
+                 (unsigned long long)(trace_.firstOnConn ? acceptToRead : 0),
+                 (unsigned long long)readToParse, (unsigned long long)parseToBuild,
+                 (unsigned long long)buildToWrite, (unsigned long long)trace_.queueUs);
+    }
+
+    trace_.started = false;
+    trace_.firstOnConn = false;
+    trace_.queueUs = 0;
+}
+
+bool HttpConn::IsMetricsRequest_() const {
+    if(metricsPath == nullptr || metricsPath[0] == '\0') {
         return false;
     }
-    else if(request_.parse(readBuff_)) {
-        LOG_DEBUG("%s", request_.path().c_str());
+    if(metricsOnAdmin && !isAdmin_) {
+        return false;
+    }
+    return request_.path() == metricsPath;
+}
+
+size_t HttpConn::ReadableBytes_() const {
+    if(bufferMode == BUFFER_RING) {
+        return readRing_.ReadableBytes();
+    } else if(bufferMode == BUFFER_CHAIN) {
+        return readChain_.ReadableBytes();
+    }
+    return readBuff_.ReadableBytes();
+}
+
+bool HttpConn::ParseRead_() {
+    if(bufferMode == BUFFER_RING) {
+        return request_.parse(readRing_);
+    } else if(bufferMode == BUFFER_CHAIN) {
+        return request_.parse(readChain_);
+    }
+    return request_.parse(readBuff_);
+}
+
+template<class BufferT>
+void HttpConn::BuildResponse_(BufferT& buff, bool parsed) {
+    if(!parsed) {
+        /* 解析失败后连接关闭；超长的请求没有对应页面，只回状态码和简单说明 */
+        int code = request_.ErrorCode();
+        response_.Init(srcDir, request_.path(), false, code > 0 ? code : 400);
+        if(code > 0 && code != 400) {
+            response_.MakeErrorResponse(buff);
+        } else {
+            response_.MakeResponse(buff);
+        }
+        return;
+    }
+    LOG_DEBUG("%s", request_.path().c_str());
+    if(IsMetricsRequest_()) {
         response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);
+        response_.MakeResponse(buff, Metrics::Instance()->Scrape(),
+                               "text/plain; version=0.0.4");
     } else {
-        response_.Init(srcDir, request_.path(), false, 400);
+        /* 管理端口只提供指标 */
+        response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), isAdmin_ ? 404 : 200);
+        response_.MakeResponse(buff);
     }
+}
 
-    response_.MakeResponse(writeBuff_);
-    /* 响应头 */
-    iov_[0].iov_base = const_cast<char*>(writeBuff_.Peek());
-    iov_[0].iov_len = writeBuff_.ReadableBytes();
+bool HttpConn::process() {
+    /* 上一个请求已处理完才重置，未完整的请求保留解析状态继续接收 */
+    if(request_.IsFinish()) {
+        request_.Init();
+    }
+    if(ReadableBytes_() <= 0) {
+        return false;
+    }
+    bool parsed = ParseRead_();
+    if(parsed && !request_.IsFinish()) {
+        return false;
+    }
+    trace_.parsed = TraceClock::now();
+    if(parsed && request_.NeedVerify()) {
+        /* 用户验证已推迟，由调用方异步执行后调用FinishVerify */
+        return false;
+    }
+    MakeResponse_(parsed);
+    return true;
+}
+
+bool HttpConn::MayBlock() const {
+    /* 验证推迟到SQL线程时，解析和构建响应都不会阻塞 */
+    if(HttpRequest::deferVerify) { return false; }
+    if(!request_.IsIdle() && !request_.IsFinish()) { return request_.method() == "POST"; }
+    /* 新请求：看读缓冲区开头的方法，数据不足以判断时按可能阻塞处理 */
+    size_t len = ReadableBytes_();
+    if(len == 0) { return false; }
+    const char* data;
+    if(bufferMode == BUFFER_RING) {
+        data = readRing_.Peek();
+    } else if(bufferMode == BUFFER_CHAIN) {
+        data = readChain_.Peek();
+        len = readChain_.BeginWriteConst() - data;
+    } else {
+        data = readBuff_.Peek();
+    }
+    return len < 4 || memcmp(data, "POST", 4) == 0;
+}
+
+std::function<bool()> HttpConn::VerifyTask() const {
+    return request_.VerifyTask();
+}
+
+std::vector<HttpRequest::VerifyStage> HttpConn::VerifyStages() const {
+    return request_.VerifyStages();
+}
+
+void HttpConn::FinishVerify(bool ok) {
+    request_.FinishVerify(ok);
+    MakeResponse_(true);
+}
+
+void HttpConn::MakeResponse_(bool parsed) {
+    bool chain = (bufferMode == BUFFER_CHAIN);
+    if(chain) {
+        BuildResponse_(writeChain_, parsed);
+    } else {
+        BuildResponse_(writeBuff_, parsed);
+    }
+    trace_.built = TraceClock::now();
+    Metrics::Instance()->CountStatus(response_.Code());
+
+    /* 响应头：BUFFER_CHAIN模式下在write时从writeChain_收集 */
+    iov_[0].iov_base = chain ? nullptr : const_cast<char*>(writeBuff_.Peek());
+    iov_[0].iov_len = chain ? 0 : writeBuff_.ReadableBytes();
     iovCnt_ = 1;
+    iov_[1].iov_base = nullptr;
+    iov_[1].iov_len = 0;
 
     /* 文件 */
     if(response_.FileLen() > 0  && response_.File()) {
@@ -114,5 +392,4 @@ bool HttpConn::process() {
         iovCnt_ = 2;
     }
     LOG_DEBUG("filesize:%d, %d  to %d", response_.FileLen() , iovCnt_, ToWriteBytes());
-    return true;
 }
@@ -7,21 +7,34 @@
 #include <arpa/inet.h>      // sockaddr_in - 网络地址结构
 #include <stdlib.h>         // atoi() - 字符串转整数
 #include <errno.h>          // 错误码定义
+#include <chrono>           // 请求耗时统计
+#include <atomic>           // 连接代数
 
 // 包含项目相关的头文件
 #include "../log/log.h"         // 日志系统
 #include "../pool/sqlconnRAII.h" // 数据库连接RAII包装器
 #include "../buffer/buffer.h"    // 自定义缓冲区类
+#include "../buffer/ringbuffer.h" // 环形缓冲区
+#include "../buffer/chainbuffer.h" // 池化的分块缓冲区
+#include "../metrics/metrics.h"  // 运行指标
 #include "httprequest.h"         // HTTP请求处理类
 #include "httpresponse.h"        // HTTP响应处理类
 
-class HttpConn {
+/* 按缓存行对齐：连接表中相邻的连接由不同线程访问时不会伪共享 */
+class alignas(64) HttpConn {
 public:
+    /* 读写缓冲区的实现方式 */
+    enum BUFFER_MODE {
+        BUFFER_VECTOR = 0,      ///< Buffer：连续数组，空间不足时搬移未读数据或扩容
+        BUFFER_RING,            ///< RingBuffer：双重映射的环形缓冲区，取走数据不搬移
+        BUFFER_CHAIN,           ///< ChainBuffer：池化的定长块链，读写两侧都用，空闲时不占内存
+    };
+
     HttpConn();   // 构造函数
     ~HttpConn();  // 析构函数
 
-    // 初始化HTTP连接
-    void init(int sockFd, const sockaddr_in& addr);
+    // 初始化HTTP连接，isAdmin表示来自管理端口的连接
+    void init(int sockFd, const sockaddr_in& addr, bool isAdmin = false);
 
     // 从套接字读取数据
     ssize_t read(int* saveErrno);
@@ -35,6 +48,9 @@ public:
     // 获取套接字文件描述符
     int GetFd() const;
 
+    // 连接的代数，每次关闭加一，用于识别fd复用后过期的epoll事件
+    uint32_t Generation() const { return generation_.load(std::memory_order_acquire); }
+
     // 获取客户端端口号
     int GetPort() const;
 
@@ -44,14 +60,64 @@ public:
     // 获取客户端地址结构
     sockaddr_in GetAddr() const;
     
-    // 处理HTTP请求
+    // 处理HTTP请求，返回false时若NeedVerify()为真，表示请求在等待用户验证
     bool process();
 
+    // 处理已读到的请求时是否可能阻塞（工作线程上同步查库验证的POST）
+    bool MayBlock() const;
+
+    // 读缓冲区中是否有尚未处理的数据
+    bool HasInput() const { return ReadableBytes_() > 0; }
+
+    // 请求已解析完，等待用户验证（HttpRequest::deferVerify时）
+    bool NeedVerify() const { return request_.NeedVerify(); }
+
+    // 生成可在其他线程执行的验证任务
+    std::function<bool()> VerifyTask() const;
+
+    // 生成按数据库操作和口令哈希拆分的验证阶段
+    std::vector<HttpRequest::VerifyStage> VerifyStages() const;
+
+    // 写回验证结果并构建响应，之后即可写出
+    void FinishVerify(bool ok);
+
     // 获取待写入的字节数
     int ToWriteBytes() { 
+        if(bufferMode == BUFFER_CHAIN) {
+            return writeChain_.ReadableBytes() + iov_[1].iov_len;
+        }
         return iov_[0].iov_len + iov_[1].iov_len; 
     }
 
+    // 长连接空闲（没有未处理的数据）时归还/缩小缓冲区，下次读写时再按需分配
+    void ReleaseIdle();
+
+    // 连接是否交给了其他线程。交出期间反应堆线程不碰连接：超时和收到的事件只用DeferIfOffloaded记下，
+    // 由持有连接的线程交还（Reclaim）时处理；持久注册（不用EPOLLONESHOT）时还记录是否有未写完的响应在等待可写
+    enum {
+        OFFLOADED = 1,          ///< 已交出
+        CLOSE_PENDING = 2,      ///< 交出期间超时，交还后关闭
+        READ_MISSED = 4,        ///< 交出期间收到的读、挂断、错误事件
+        WRITE_MISSED = 8,       ///< 交出期间收到的可写事件
+    };
+    bool Offloaded() const { return (state_.load(std::memory_order_acquire) & OFFLOADED) != 0; }
+    void SetOffloaded(bool offloaded) {
+        if(offloaded) { state_.fetch_or(OFFLOADED, std::memory_order_acq_rel); }
+        else { Reclaim(); }
+    }
+    bool DeferIfOffloaded(int flags);   // 反应堆线程调用：连接已交出时记下flags并返回true
+    int Reclaim() { return state_.exchange(0, std::memory_order_acq_rel); }  // 交还连接，返回交出期间记下的标记
+    bool WantWrite() const { return wantWrite_; }
+    void SetWantWrite(bool wantWrite) { wantWrite_ = wantWrite; }
+
+    // 是否已加入epoll：accept后试读直接处理的连接暂不注册，由第一次等待事件时加入
+    bool Registered() const { return registered_; }
+    void SetRegistered(bool registered) { registered_ = registered; }
+
+    // 线程池投递/取出时打点，累计请求在队列中的等待时间
+    void MarkQueued();
+    void MarkDequeued();
+
     // 检查是否为Keep-Alive连接
     bool IsKeepAlive() const {
         return request_.IsKeepAlive();
@@ -61,19 +127,59 @@ public:
     static bool isET;                    // 是否为边缘触发模式
     static const char* srcDir;           // 服务器根目录
     static std::atomic<int> userCount;   // 当前连接用户数（原子操作）
+    static const char* metricsPath;      // 指标路径，空字符串表示关闭
+    static bool metricsOnAdmin;          // 指标是否只在管理端口提供
+    static int slowRequestMs;            // 慢请求日志阈值（毫秒），0表示关闭
+    static int bufferMode;               // 读写缓冲区实现，见BUFFER_MODE
+    static int idleBufferKB;             // 空闲连接保留的缓冲区上限（KB），超过即释放，-1表示不释放
     
 private:
+    typedef std::chrono::steady_clock TraceClock;
+
+    /* 单个请求各阶段的时间点，用于耗时分解 */
+    struct Trace {
+        TraceClock::time_point accept;      // 连接建立
+        TraceClock::time_point firstRead;   // 读到请求首字节
+        TraceClock::time_point parsed;      // 解析完成
+        TraceClock::time_point built;       // 响应构建完成
+        TraceClock::time_point queued;      // 最近一次投递到线程池
+        uint64_t queueUs;                   // 本请求在线程池队列中的累计等待
+        bool started;                       // firstRead是否有效
+        bool firstOnConn;                   // 是否为连接上的第一个请求
+    };
+
+    bool IsMetricsRequest_() const;      // 当前请求是否为指标抓取
+    void FinishTrace_();                 // 响应写完：记录各阶段直方图，超阈值时输出慢请求日志
+    size_t ReadableBytes_() const;       // 当前读缓冲区中未解析的字节数
+
+    static const size_t MAX_READ_BYTES;  // 读缓冲区中未解析数据的上限，超过时停止读取并关闭连接
+    bool ParseRead_();                   // 从当前读缓冲区解析请求
+    template<class BufferT>
+    void BuildResponse_(BufferT& buff, bool parsed);    // 按解析结果把响应头写入buff
+    void MakeResponse_(bool parsed);     // 构建响应并设置待写出的iovec
+    ssize_t WriteChain_(int* saveErrno, uint64_t& total);  // BUFFER_CHAIN模式：响应头各块与文件合并为一次writev
+
    
     int fd_;                    // 套接字文件描述符
     struct sockaddr_in addr_;   // 客户端地址结构
 
     bool isClose_;              // 连接是否已关闭
+    std::atomic<uint32_t> generation_;  // 关闭次数
+    bool isAdmin_;              // 是否为管理端口连接（只提供指标）
+    std::atomic<int> state_;    // 交出标记及交出期间记下的事件（OFFLOADED等）
+    bool wantWrite_;            // 等待可写，由持有连接的线程读写
+    bool registered_;           // 已加入epoll，由持有连接的线程读写
+
+    Trace trace_;               // 当前请求的耗时分解
     
     int iovCnt_;                // iovec数组中的元素个数
     struct iovec iov_[2];       // 向量化I/O结构数组，用于writev操作
     
     Buffer readBuff_;           // 读缓冲区，存储从客户端接收的数据
+    RingBuffer readRing_;       // 环形读缓冲区，bufferMode为BUFFER_RING时代替readBuff_，首次读取时才映射
     Buffer writeBuff_;          // 写缓冲区，存储要发送给客户端的数据
+    ChainBuffer readChain_;     // bufferMode为BUFFER_CHAIN时代替readBuff_
+    ChainBuffer writeChain_;    // bufferMode为BUFFER_CHAIN时代替writeBuff_
 
     HttpRequest request_;       // HTTP请求处理对象
     HttpResponse response_;     // HTTP响应处理对象
@@ -1,4 +1,6 @@
 #include "httprequest.h"
+#include <algorithm>
+#include <ctype.h>
 using namespace std;
 
 const unordered_set<string> HttpRequest::DEFAULT_HTML{
@@ -8,28 +10,92 @@ const unordered_set<string> HttpRequest::DEFAULT_HTML{
 const unordered_map<string, int> HttpRequest::DEFAULT_HTML_TAG {
             {"/register.html", 0}, {"/login.html", 1},  };
 
+const size_t HttpRequest::MAX_LINE;
+const size_t HttpRequest::MAX_HEADER_BYTES;
+const size_t HttpRequest::MAX_BODY;
+
+bool HttpRequest::deferVerify = false;
+HttpRequest::Verifier HttpRequest::verifier = &HttpRequest::UserVerify;
+
 void HttpRequest::Init() {
     method_ = path_ = version_ = body_ = "";
     state_ = REQUEST_LINE;
+    verifyPending_ = false;
+    verifyLogin_ = false;
+    errorCode_ = 0;
+    headerBytes_ = 0;
     header_.clear();
     post_.clear();
 }
 
+void HttpRequest::Shrink() {
+    assert(IsIdle());
+    /* clear()保留容量和桶数组，swap到空对象才会真正释放 */
+    std::string().swap(method_);
+    std::string().swap(path_);
+    std::string().swap(version_);
+    std::string().swap(body_);
+    std::unordered_map<std::string, std::string>().swap(header_);
+    std::unordered_map<std::string, std::string>().swap(post_);
+}
+
 bool HttpRequest::IsKeepAlive() const {
-    if(header_.count("Connection") == 1) {
-        return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
+    if(header_.count("connection") == 1) {
+        return header_.find("connection")->second == "keep-alive" && version_ == "1.1";
     }
     return false;
 }
 
-bool HttpRequest::parse(Buffer& buff) {
+/* Buffer与RingBuffer的可读数据本身连续；ChainBuffer只有第一块连续，找不到行尾时合并下一块 */
+template<class BufferT>
+static bool PullupLine(BufferT&) {
+    return false;
+}
+
+static bool PullupLine(ChainBuffer& buff) {
+    return buff.PullupNext();
+}
+
+/* 取出len字节作为请求体 */
+template<class BufferT>
+static std::string TakeBody(BufferT& buff, size_t len) {
+    std::string body(buff.Peek(), len);
+    buff.Retrieve(len);
+    return body;
+}
+
+static std::string TakeBody(ChainBuffer& buff, size_t len) {
+    return buff.RetrieveToStr(len);
+}
+
+template<class BufferT>
+bool HttpRequest::Parse_(BufferT& buff) {
     const char CRLF[] = "\r\n";
     if(buff.ReadableBytes() <= 0) {
         return false;
     }
     while(buff.ReadableBytes() && state_ != FINISH) {
+        if(state_ == BODY) {
+            /* 请求体按Content-Length接收完整后再解析 */
+            size_t len = ContentLength_();
+            if(buff.ReadableBytes() < len) { break; }
+            ParseBody_(TakeBody(buff, len));
+            break;
+        }
         const char* lineEnd = search(buff.Peek(), buff.BeginWriteConst(), CRLF, CRLF + 2);
+        /* 行或请求头超长时不再等待后续数据，避免一个连接无限制地占用缓冲区 */
+        size_t lineLen = lineEnd - buff.Peek();
+        if(lineLen > MAX_LINE || headerBytes_ + lineLen > MAX_HEADER_BYTES) {
+            return Reject_(state_ == REQUEST_LINE ? 414 : 431);
+        }
+        if(lineEnd == buff.BeginWriteConst()) {
+            /* 行跨越了不连续的内存时合并后重找，否则行不完整，等待后续数据 */
+            if(PullupLine(buff)) { continue; }
+            break;
+        }
+        headerBytes_ += lineLen + 2;
         std::string line(buff.Peek(), lineEnd);
+        buff.RetrieveUntil(lineEnd + 2);
         switch(state_)
         {
         case REQUEST_LINE:
@@ -40,23 +106,46 @@ bool HttpRequest::parse(Buffer& buff) {
             break;    
         case HEADERS:
             ParseHeader_(line);
-            if(buff.ReadableBytes() <= 2) {
-                state_ = FINISH;
+            if(state_ == BODY && ContentLength_() > MAX_BODY) {
+                return Reject_(413);
             }
             break;
-        case BODY:
-            ParseBody_(line);
-            break;
         default:
             break;
         }
-        if(lineEnd == buff.BeginWrite()) { break; }
-        buff.RetrieveUntil(lineEnd + 2);
     }
-    LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
+    if(state_ == FINISH) {
+        LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
+    }
     return true;
 }
 
+bool HttpRequest::parse(Buffer& buff) {
+    return Parse_(buff);
+}
+
+bool HttpRequest::parse(RingBuffer& buff) {
+    return Parse_(buff);
+}
+
+bool HttpRequest::parse(ChainBuffer& buff) {
+    return Parse_(buff);
+}
+
+bool HttpRequest::Reject_(int code) {
+    errorCode_ = code;
+    LOG_WARN("Request rejected: %d", code);
+    return false;
+}
+
+size_t HttpRequest::ContentLength_() const {
+    auto it = header_.find("content-length");
+    if(it == header_.end()) {
+        return 0;
+    }
+    return strtoul(it->second.c_str(), nullptr, 10);
+}
+
 void HttpRequest::ParsePath_() {
     if(path_ == "/") {
         path_ = "/index.html"; 
@@ -82,17 +171,21 @@ bool HttpRequest::ParseRequestLine_(const string& line) {
         return true;
     }
     LOG_ERROR("RequestLine Error");
-    return false;
+    return Reject_(400);
 }
 
 void HttpRequest::ParseHeader_(const string& line) {
     regex patten("^([^:]*): ?(.*)$");
     smatch subMatch;
     if(regex_match(line, subMatch, patten)) {
-        header_[subMatch[1]] = subMatch[2];
+        /* 请求头名不区分大小写 */
+        std::string key = subMatch[1];
+        transform(key.begin(), key.end(), key.begin(), ::tolower);
+        header_[key] = subMatch[2];
     }
     else {
-        state_ = BODY;
+        /* 空行：请求头结束，没有请求体时请求已完整 */
+        state_ = ContentLength_() > 0 ? BODY : FINISH;
     }
 }
 
@@ -110,18 +203,19 @@ int HttpRequest::ConverHex(char ch) {
 }
 
 void HttpRequest::ParsePost_() {
-    if(method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded") {
+    if(method_ == "POST" && header_["content-type"] == "application/x-www-form-urlencoded") {
         ParseFromUrlencoded_();
         if(DEFAULT_HTML_TAG.count(path_)) {
             int tag = DEFAULT_HTML_TAG.find(path_)->second;
             LOG_DEBUG("Tag:%d", tag);
             if(tag == 0 || tag == 1) {
-                bool isLogin = (tag == 1);
-                if(UserVerify(post_["username"], post_["password"], isLogin)) {
-                    path_ = "/welcome.html";
-                } 
-                else {
-                    path_ = "/error.html";
+                verifyLogin_ = (tag == 1);
+                verifyPending_ = true;
+                bool ok = false;
+                if(UserCache::Instance()->TryVerify(post_["username"], post_["password"], verifyLogin_, ok)) {
+                    FinishVerify(ok);   // 缓存能确定结果，不查库
+                } else if(!deferVerify) {
+                    FinishVerify(verifier(post_["username"], post_["password"], verifyLogin_));
                 }
             }
         }
@@ -169,65 +263,105 @@ void HttpRequest::ParseFromUrlencoded_() {
     }
 }
 
-bool HttpRequest::UserVerify(const string &name, const string &pwd, bool isLogin) {
-    if(name == "" || pwd == "") { return false; }
-    LOG_INFO("Verify name:%s pwd:%s", name.c_str(), pwd.c_str());
-    MYSQL* sql;
-    SqlConnRAII sql_conn_(&sql,  SqlConnPool::Instance());
-    assert(sql);
-    
-    bool flag = false;
-    unsigned int j = 0;
-    char order[256] = { 0 };
-    MYSQL_FIELD *fields = nullptr;
-    MYSQL_RES *res = nullptr;
-    
-    if(!isLogin) { flag = true; }
-    /* 查询用户及密码 */
-    snprintf(order, 256, "SELECT username, password FROM user WHERE username='%s' LIMIT 1", name.c_str());
-    LOG_DEBUG("%s", order);
-
-    if(mysql_query(sql, order)) { 
-        // mysql_free_result(res);
-        return false; 
+std::function<bool()> HttpRequest::VerifyTask() const {
+    assert(verifyPending_);
+    /* 复制参数：任务执行期间连接可能被关闭并复用，不能引用本对象 */
+    std::string name = GetPost("username");
+    std::string pwd = GetPost("password");
+    bool isLogin = verifyLogin_;
+    Verifier verify = verifier;
+    return [name, pwd, isLogin, verify]() { return verify(name, pwd, isLogin); };
+}
+
+std::vector<HttpRequest::VerifyStage> HttpRequest::VerifyStages() const {
+    assert(verifyPending_);
+    std::string name = GetPost("username");
+    std::string pwd = GetPost("password");
+    std::vector<VerifyStage> stages;
+    if(name.empty() || pwd.empty()) {
+        stages.push_back({false, []() { return false; }, nullptr});
+        return stages;
     }
-    res = mysql_store_result(sql);
-    j = mysql_num_fields(res);
-    fields = mysql_fetch_fields(res);
-
-    while(MYSQL_ROW row = mysql_fetch_row(res)) {
-        LOG_DEBUG("MYSQL ROW: %s %s", row[0], row[1]);
-        string password(row[1]);
-        /* 注册行为 且 用户名未被使用*/
-        if(isLogin) {
-            if(pwd == password) { flag = true; }
-            else {
-                flag = false;
-                LOG_DEBUG("pwd error!");
-            }
-        } 
-        else { 
-            flag = false; 
-            LOG_DEBUG("user used!");
+    /* 两个阶段通过stored传递口令记录：登录先查库取记录再验证口令，注册先算哈希再写库 */
+    std::shared_ptr<std::string> stored = std::make_shared<std::string>();
+    if(verifyLogin_) {
+        stages.push_back({false, [name, stored]() { return UserFetch_(name, *stored); }, nullptr});
+        stages.push_back({true, [name, pwd, stored]() { return CheckPassword_(name, pwd, *stored); }, nullptr});
+    } else {
+        stages.push_back({true, [pwd, stored]() {
+            *stored = PasswordHash::Hash(pwd);
+            return true;
+        }, nullptr});
+        if(RegisterBatcher::Instance()->Enabled()) {
+            /* 交给批量写入线程，不占用SQL线程等待 */
+            stages.push_back({false, nullptr, [name, stored](std::function<void(bool)> done) {
+                RegisterBatcher::Instance()->Submit(name, *stored, done);
+            }});
+        } else {
+            stages.push_back({false, [name, stored]() { return UserRegister_(name, *stored); }, nullptr});
         }
     }
-    mysql_free_result(res);
+    return stages;
+}
+
+void HttpRequest::FinishVerify(bool ok) {
+    assert(verifyPending_);
+    verifyPending_ = false;
+    path_ = ok ? "/welcome.html" : "/error.html";
+}
+
+bool HttpRequest::UserFetch_(const string& name, string& stored) {
+    int ret = UserStore::Instance()->Fetch(name, stored);
+
+    /* 把查库结果记入缓存：明文记录直接缓存，哈希记录要等口令验证通过（CheckPassword_）才能缓存 */
+    UserCache* cache = UserCache::Instance();
+    if(ret == 0) {
+        cache->PutMissing(name);
+    } else if(ret > 0 && !stored.empty() && !PasswordHash::IsHashed(stored)) {
+        cache->PutUser(name, stored);
+    }
+    return ret > 0;
+}
+
+bool HttpRequest::CheckPassword_(const string& name, const string& pwd, const string& stored) {
+    if(stored.empty() || !PasswordHash::Verify(pwd, stored)) {
+        LOG_DEBUG("pwd error!");
+        return false;
+    }
+    UserCache::Instance()->PutUser(name, pwd);
+    return true;
+}
+
+bool HttpRequest::UserRegister_(const string& name, const string& stored) {
+    if(RegisterBatcher::Instance()->Enabled()) {
+        /* 与其他注册攒批写入，阻塞等待本批写完（最长约registerBatchMs加一次写库），只应在SQL线程上调用 */
+        return RegisterBatcher::Instance()->Register(name, stored);
+    }
+    /* 若缓存或Bloom过滤器认为用户名不存在、且存储有唯一约束兜底，省去查重 */
+    UserCache* cache = UserCache::Instance();
+    bool knownMissing = cache->SkipDuplicateCheck(name);
 
     /* 注册行为 且 用户名未被使用*/
-    if(!isLogin && flag == true) {
-        LOG_DEBUG("regirster!");
-        bzero(order, 256);
-        snprintf(order, 256,"INSERT INTO user(username, password) VALUES('%s','%s')", name.c_str(), pwd.c_str());
-        LOG_DEBUG( "%s", order);
-        if(mysql_query(sql, order)) { 
-            LOG_DEBUG( "Insert error!");
-            flag = false; 
-        }
-        flag = true;
+    vector<char> ok;
+    UserStore::Instance()->Insert({{name, stored, !knownMissing}}, ok);
+    if(!ok[0]) {
+        LOG_DEBUG("user used!");
+        return false;
     }
-    // SqlConnPool::Instance()->FreeConn(sql);
+    cache->Invalidate(name);
+    cache->AddName(name);
     LOG_DEBUG( "UserVerify success!!");
-    return flag;
+    return true;
+}
+
+bool HttpRequest::UserVerify(const string &name, const string &pwd, bool isLogin) {
+    if(name == "" || pwd == "") { return false; }
+    LOG_INFO("Verify name:%s", name.c_str());
+    if(isLogin) {
+        string stored;
+        return UserFetch_(name, stored) && CheckPassword_(name, pwd, stored);
+    }
+    return UserRegister_(name, PasswordHash::Hash(pwd));
 }
 
 std::string HttpRequest::path() const{
@@ -5,13 +5,19 @@
 #include <unordered_set>
 #include <string>
 #include <regex>
+#include <functional>
+#include <vector>
+#include <memory>
 #include <errno.h>     
-#include <mysql/mysql.h>  //mysql
 
 #include "../buffer/buffer.h"
+#include "../buffer/ringbuffer.h"
+#include "../buffer/chainbuffer.h"
 #include "../log/log.h"
-#include "../pool/sqlconnpool.h"
-#include "../pool/sqlconnRAII.h"
+#include "../user/usercache.h"
+#include "../user/passwordhash.h"
+#include "../user/registerbatcher.h"
+#include "../user/userstore.h"
 
 class HttpRequest {
 public:
@@ -37,7 +43,13 @@ public:
     ~HttpRequest() = default;    ///< 析构函数
 
     void Init();                 ///< 初始化所有成员变量
-    bool parse(Buffer& buff);    ///< 解析HTTP请求的主方法
+    bool parse(Buffer& buff);    ///< 解析HTTP请求的主方法，数据不完整时保留状态等待后续数据
+    bool parse(RingBuffer& buff);///< 同上，读缓冲区为环形缓冲区时使用
+    bool parse(ChainBuffer& buff);///< 同上，读缓冲区为块链时使用，跨块的行会先合并
+    bool IsFinish() const { return state_ == FINISH; }  ///< 是否已解析出完整请求
+    bool IsIdle() const { return state_ == REQUEST_LINE; }  ///< 是否处于两个请求之间（尚未解析任何内容）
+    int ErrorCode() const { return errorCode_; }  ///< parse返回false时应答的状态码：400格式错误，413请求体、414请求行、431请求头超长
+    void Shrink();               ///< 释放字符串和哈希表占用的内存，只在IsIdle()时调用
 
     std::string path() const;    ///< 获取请求路径（只读）
     std::string& path();         ///< 获取请求路径（可修改）
@@ -48,6 +60,29 @@ public:
 
     bool IsKeepAlive() const;    ///< 检查是否为长连接
 
+    /* 登录/注册的用户验证：deferVerify为false时在解析过程中同步执行；
+       为true时解析只记下待验证，由调用方在别的线程上执行VerifyTask()后通过FinishVerify写回结果 */
+    typedef bool (*Verifier)(const std::string& name, const std::string& pwd, bool isLogin);
+    bool NeedVerify() const { return verifyPending_; }  ///< 请求已解析完，但用户验证尚未完成
+    std::function<bool()> VerifyTask() const;           ///< 按当前用户名密码生成验证任务（复制参数，可在其他线程执行）
+    void FinishVerify(bool ok);                         ///< 写回验证结果，跳转到欢迎页或错误页
+
+    /* 按资源拆分的验证：数据库操作与口令哈希分成前后两个阶段，调用方把它们分别交给SQL线程和哈希线程，
+       前一阶段返回true才执行下一阶段，全部为true时验证通过；不经过verifier */
+    struct VerifyStage {
+        bool cpu;                       ///< true为口令哈希（耗CPU），false为数据库操作
+        std::function<bool()> run;
+        std::function<void(std::function<void(bool)>)> async;  ///< 非空时为异步阶段：直接调用，完成后在其他线程回调结果（如注册批量写入）
+    };
+    std::vector<VerifyStage> VerifyStages() const;
+
+    static const size_t MAX_LINE = 8192;            ///< 请求行、单个请求头的长度上限
+    static const size_t MAX_HEADER_BYTES = 32768;   ///< 请求行加全部请求头的长度上限
+    static const size_t MAX_BODY = 1 << 20;         ///< 请求体（Content-Length）上限
+
+    static bool deferVerify;     ///< 是否推迟用户验证
+    static Verifier verifier;    ///< 验证的实现，默认UserVerify查询MySQL，测试时可换成模拟后端
+
     /* 
     todo 
     void HttpConn::ParseFormData() {}
@@ -55,6 +90,11 @@ public:
     */
 
 private:
+    template<class BufferT>
+    bool Parse_(BufferT& buff);                         ///< parse的通用实现，BufferT需提供Peek/Retrieve等接口
+    size_t ContentLength_() const;                      ///< 请求头中的Content-Length，缺省为0
+    bool Reject_(int code);                             ///< 记下错误状态码，返回false
+
     bool ParseRequestLine_(const std::string& line);    ///< 解析HTTP请求行
     void ParseHeader_(const std::string& line);         ///< 解析HTTP请求头
     void ParseBody_(const std::string& line);           ///< 解析HTTP请求体
@@ -64,10 +104,18 @@ private:
     void ParseFromUrlencoded_(); ///< 解析URL编码的表单数据
 
     static bool UserVerify(const std::string& name, const std::string& pwd, bool isLogin);  ///< 用户验证方法
+    static bool UserFetch_(const std::string& name, std::string& stored);   ///< 从用户存储取口令记录，用户不存在时返回false
+    static bool CheckPassword_(const std::string& name, const std::string& pwd,
+                               const std::string& stored);                 ///< 按口令记录验证口令（可能耗时）
+    static bool UserRegister_(const std::string& name, const std::string& stored);  ///< 用户名未被使用时写入新用户
 
     PARSE_STATE state_;                                    ///< 当前解析状态
+    bool verifyPending_;                                   ///< 等待用户验证结果
+    bool verifyLogin_;                                     ///< 待验证的是登录（否则为注册）
+    int errorCode_;                                        ///< 解析失败时的状态码
+    size_t headerBytes_;                                   ///< 已解析的请求行和请求头字节数
     std::string method_, path_, version_, body_;          ///< HTTP请求的基本信息
-    std::unordered_map<std::string, std::string> header_; ///< 请求头键值对
+    std::unordered_map<std::string, std::string> header_; ///< 请求头键值对，键统一转为小写
     std::unordered_map<std::string, std::string> post_;   ///< POST请求参数键值对
 
     static const std::unordered_set<std::string> DEFAULT_HTML;        ///< 默认HTML页面路径集合
@@ -29,6 +29,9 @@ const unordered_map<int, string> HttpResponse::CODE_STATUS = {
     { 400, "Bad Request" },
     { 403, "Forbidden" },
     { 404, "Not Found" },
+    { 413, "Payload Too Large" },
+    { 414, "URI Too Long" },
+    { 431, "Request Header Fields Too Large" },
 };
 
 const unordered_map<int, string> HttpResponse::CODE_PATH = {
@@ -60,7 +63,8 @@ void HttpResponse::Init(const string& srcDir, string& path, bool isKeepAlive, in
     mmFileStat_ = { 0 };
 }
 
-void HttpResponse::MakeResponse(Buffer& buff) {
+template<class BufferT>
+void HttpResponse::MakeResponse(BufferT& buff) {
     /* 判断请求的资源文件 */
     if(stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
         code_ = 404;
@@ -77,6 +81,24 @@ void HttpResponse::MakeResponse(Buffer& buff) {
     AddContent_(buff);
 }
 
+template<class BufferT>
+void HttpResponse::MakeResponse(BufferT& buff, const string& body, const string& type) {
+    if(code_ == -1) {
+        code_ = 200;
+    }
+    AddStateLine_(buff);
+    AddHeader_(buff, type);
+    buff.Append("Content-length: " + to_string(body.size()) + "\r\n\r\n");
+    buff.Append(body);
+}
+
+template<class BufferT>
+void HttpResponse::MakeErrorResponse(BufferT& buff) {
+    AddStateLine_(buff);
+    AddHeader_(buff, "text/html");
+    ErrorContent(buff, "Request too large!");
+}
+
 char* HttpResponse::File() {
     return mmFile_;
 }
@@ -92,7 +114,8 @@ void HttpResponse::ErrorHtml_() {
     }
 }
 
-void HttpResponse::AddStateLine_(Buffer& buff) {
+template<class BufferT>
+void HttpResponse::AddStateLine_(BufferT& buff) {
     string status;
     if(CODE_STATUS.count(code_) == 1) {
         status = CODE_STATUS.find(code_)->second;
@@ -104,7 +127,13 @@ void HttpResponse::AddStateLine_(Buffer& buff) {
     buff.Append("HTTP/1.1 " + to_string(code_) + " " + status + "\r\n");
 }
 
-void HttpResponse::AddHeader_(Buffer& buff) {
+template<class BufferT>
+void HttpResponse::AddHeader_(BufferT& buff) {
+    AddHeader_(buff, GetFileType_());
+}
+
+template<class BufferT>
+void HttpResponse::AddHeader_(BufferT& buff, const string& type) {
     buff.Append("Connection: ");
     if(isKeepAlive_) {
         buff.Append("keep-alive\r\n");
@@ -112,10 +141,11 @@ void HttpResponse::AddHeader_(Buffer& buff) {
     } else{
         buff.Append("close\r\n");
     }
-    buff.Append("Content-type: " + GetFileType_() + "\r\n");
+    buff.Append("Content-type: " + type + "\r\n");
 }
 
-void HttpResponse::AddContent_(Buffer& buff) {
+template<class BufferT>
+void HttpResponse::AddContent_(BufferT& buff) {
     int srcFd = open((srcDir_ + path_).data(), O_RDONLY);
     if(srcFd < 0) { 
         ErrorContent(buff, "File NotFound!");
@@ -155,7 +185,8 @@ string HttpResponse::GetFileType_() {
     return "text/plain";
 }
 
-void HttpResponse::ErrorContent(Buffer& buff, string message) 
+template<class BufferT>
+void HttpResponse::ErrorContent(BufferT& buff, string message) 
 {
     string body;
     string status;
@@ -173,3 +204,13 @@ void HttpResponse::ErrorContent(Buffer& buff, string message)
     buff.Append("Content-length: " + to_string(body.size()) + "\r\n\r\n");
     buff.Append(body);
 }
+
+/* 显式实例化：响应可写入连续缓冲区或块链 */
+template void HttpResponse::MakeResponse<Buffer>(Buffer& buff);
+template void HttpResponse::MakeResponse<ChainBuffer>(ChainBuffer& buff);
+template void HttpResponse::MakeResponse<Buffer>(Buffer& buff, const string& body, const string& type);
+template void HttpResponse::MakeResponse<ChainBuffer>(ChainBuffer& buff, const string& body, const string& type);
+template void HttpResponse::MakeErrorResponse<Buffer>(Buffer& buff);
+template void HttpResponse::MakeErrorResponse<ChainBuffer>(ChainBuffer& buff);
+template void HttpResponse::ErrorContent<Buffer>(Buffer& buff, string message);
+template void HttpResponse::ErrorContent<ChainBuffer>(ChainBuffer& buff, string message);
@@ -9,6 +9,7 @@
 #include <sys/mman.h>    // mmap, munmap - 内存映射
 
 #include "../buffer/buffer.h"  // 自定义缓冲区类
+#include "../buffer/chainbuffer.h"  // 块链缓冲区
 #include "../log/log.h"        // 日志系统
 
 class HttpResponse {
@@ -18,8 +19,15 @@ public:
 
     // 初始化HTTP响应对象
     void Init(const std::string& srcDir, std::string& path, bool isKeepAlive = false, int code = -1);
-    // 构建完整的HTTP响应
-    void MakeResponse(Buffer& buff);
+    // 构建完整的HTTP响应，BufferT为Buffer或ChainBuffer
+    template<class BufferT>
+    void MakeResponse(BufferT& buff);
+    // 以内存中的内容作为响应体构建响应（不访问文件）
+    template<class BufferT>
+    void MakeResponse(BufferT& buff, const std::string& body, const std::string& type);
+    // 构建没有对应页面的错误响应（如请求超长），响应体为简单的错误说明
+    template<class BufferT>
+    void MakeErrorResponse(BufferT& buff);
     // 解除内存映射
     void UnmapFile();
     // 获取内存映射文件的指针
@@ -27,17 +35,23 @@ public:
     // 获取文件长度
     size_t FileLen() const;
     // 添加错误内容到缓冲区
-    void ErrorContent(Buffer& buff, std::string message);
+    template<class BufferT>
+    void ErrorContent(BufferT& buff, std::string message);
     // 获取HTTP状态码
     int Code() const { return code_; }
 
 private:
     // 添加HTTP状态行到缓冲区
-    void AddStateLine_(Buffer &buff);
+    template<class BufferT>
+    void AddStateLine_(BufferT& buff);
     // 添加HTTP头部到缓冲区
-    void AddHeader_(Buffer &buff);
+    template<class BufferT>
+    void AddHeader_(BufferT& buff);
+    template<class BufferT>
+    void AddHeader_(BufferT& buff, const std::string& type);
     // 添加响应内容到缓冲区
-    void AddContent_(Buffer &buff);
+    template<class BufferT>
+    void AddContent_(BufferT& buff);
 
     // 生成错误页面的HTML内容
     void ErrorHtml_();
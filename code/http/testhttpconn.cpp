@@ -46,13 +46,13 @@ void cleanupTestDir() {
 void testConstructor() {
     std::cout << "测试构造函数和析构函数..." << std::endl;
     
-    HttpConn* conn = new HttpConn();
-    assert(conn != nullptr);
-    
-    // 检查初始状态
-    assert(conn->GetFd() == -1);
-    
-    delete conn;
+    {
+        /* HttpConn按缓存行对齐，C++11的new不保证对齐，放在栈上构造、离开作用域析构 */
+        HttpConn conn;
+        
+        // 检查初始状态
+        assert(conn.GetFd() == -1);
+    }
     std::cout << "✓ 构造函数和析构函数测试通过" << std::endl;
 }
 
@@ -219,6 +219,162 @@ void testToWriteBytes() {
     std::cout << "✓ 待写入字节数计算测试通过" << std::endl;
 }
 
+// 模拟的验证后端，代替MySQL
+static bool mockVerify(const std::string& name, const std::string& pwd, bool isLogin) {
+    return isLogin && name == "root" && pwd == "1";
+}
+
+// 测试推迟的用户验证：解析后等待验证，写回结果后才构建响应
+void testDeferredVerify() {
+    std::cout << "测试推迟的用户验证..." << std::endl;
+
+    HttpRequest::Verifier oldVerifier = HttpRequest::verifier;
+    HttpRequest::deferVerify = true;
+    HttpRequest::verifier = &mockVerify;
+    FILE* fp = fopen("./test_files/welcome.html", "w");
+    if (fp) {
+        fprintf(fp, "<html><body>welcome</body></html>");
+        fclose(fp);
+    }
+
+    int fds[2];
+    int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    assert(ret == 0);
+    struct sockaddr_in addr = { 0 };
+    HttpConn conn;
+    conn.init(fds[0], addr);
+
+    const char* req = "POST /login HTTP/1.1\r\n"
+                      "Content-Type: application/x-www-form-urlencoded\r\n"
+                      "Content-Length: 24\r\n"
+                      "\r\n"
+                      "username=root&password=1";
+    ssize_t n = ::write(fds[1], req, strlen(req));
+    assert(n == (ssize_t)strlen(req));
+    int err = 0;
+    n = conn.read(&err);
+    assert(n > 0);
+
+    /* 请求已完整，但在验证结果写回前不产生响应 */
+    bool processed = conn.process();
+    assert(!processed);
+    assert(conn.NeedVerify());
+    assert(conn.ToWriteBytes() == 0);
+
+    /* 验证任务复制了参数，可在任何线程执行 */
+    std::function<bool()> task = conn.VerifyTask();
+    bool ok = task();
+    assert(ok);
+    conn.FinishVerify(ok);
+    assert(!conn.NeedVerify());
+    assert(conn.ToWriteBytes() > 0);
+
+    n = conn.write(&err);
+    assert(n > 0);
+    char resp[4096] = { 0 };
+    n = ::read(fds[1], resp, sizeof(resp) - 1);
+    assert(n > 0);
+    assert(strstr(resp, "200 OK") && strstr(resp, "welcome"));
+
+    conn.Close();
+    close(fds[1]);
+    HttpRequest::deferVerify = false;
+    HttpRequest::verifier = oldVerifier;
+    std::cout << "✓ 推迟的用户验证测试通过" << std::endl;
+}
+
+// 测试内联模式的分类：同步验证的POST可能阻塞，GET和推迟验证的POST不会
+void testMayBlock() {
+    std::cout << "测试请求是否可能阻塞..." << std::endl;
+
+    int fds[2];
+    int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    assert(ret == 0);
+    struct sockaddr_in addr = { 0 };
+    HttpConn conn;
+    conn.init(fds[0], addr);
+    int err = 0;
+
+    assert(!conn.MayBlock());   // 没有数据
+    const char* get = "GET /index.html HTTP/1.1\r\n\r\n";
+    assert(::write(fds[1], get, strlen(get)) == (ssize_t)strlen(get));
+    assert(conn.read(&err) > 0);
+    assert(!conn.MayBlock());
+    assert(conn.process());
+    conn.write(&err);
+
+    const char* post = "POST /login HTTP/1.1\r\nContent-Length: 24\r\n\r\nusername=root&password=1";
+    assert(::write(fds[1], post, strlen(post)) == (ssize_t)strlen(post));
+    assert(conn.read(&err) > 0);
+    assert(conn.MayBlock());
+    HttpRequest::deferVerify = true;
+    assert(!conn.MayBlock());
+    HttpRequest::deferVerify = false;
+
+    conn.Close();
+    close(fds[1]);
+    std::cout << "✓ 请求是否可能阻塞测试通过" << std::endl;
+}
+
+// 测试用户态的连接状态：交出/交还、交出期间记下的超时和事件、等待可写，连接复用时与注册标记一起复位
+void testPersistentState() {
+    std::cout << "测试持久注册状态..." << std::endl;
+
+    int fds[2];
+    int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    assert(ret == 0);
+    struct sockaddr_in addr = { 0 };
+    HttpConn conn;
+    conn.init(fds[0], addr);
+    int err = 0;
+    assert(!conn.Offloaded());
+    assert(!conn.WantWrite());
+    assert(!conn.Registered());
+    conn.SetRegistered(true);
+
+    /* 交给工作线程处理，处理完有响应要写：记录写意愿后交还 */
+    const char* get = "GET /index.html HTTP/1.1\r\nConnection: keep-alive\r\n\r\n";
+    assert(::write(fds[1], get, strlen(get)) == (ssize_t)strlen(get));
+    assert(conn.read(&err) > 0);
+    conn.SetOffloaded(true);
+    assert(conn.Offloaded());
+    assert(conn.process());
+    conn.SetWantWrite(conn.ToWriteBytes() > 0);
+    conn.SetOffloaded(false);
+    assert(conn.WantWrite() && !conn.Offloaded());
+
+    /* 交出期间反应堆线程只记下超时和事件，交还时一并取回 */
+    assert(!conn.DeferIfOffloaded(HttpConn::CLOSE_PENDING));
+    conn.SetOffloaded(true);
+    assert(conn.DeferIfOffloaded(HttpConn::READ_MISSED));
+    assert(conn.DeferIfOffloaded(HttpConn::CLOSE_PENDING));
+    conn.SetOffloaded(true);    // 再次交出（如转去验证）不丢已记下的标记
+    assert(conn.Reclaim() == (HttpConn::OFFLOADED | HttpConn::CLOSE_PENDING | HttpConn::READ_MISSED));
+    assert(!conn.Offloaded() && conn.Reclaim() == 0);
+
+    /* 写完后回到等待读 */
+    conn.write(&err);
+    assert(conn.ToWriteBytes() == 0);
+    conn.SetWantWrite(false);
+    assert(!conn.WantWrite());
+
+    /* 交出期间关闭（如超时），同一对象被新连接复用时状态复位 */
+    conn.SetOffloaded(true);
+    conn.SetWantWrite(true);
+    conn.Close();
+    close(fds[1]);
+    ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    assert(ret == 0);
+    conn.init(fds[0], addr);
+    assert(!conn.Offloaded());
+    assert(!conn.WantWrite());
+    assert(!conn.Registered());
+
+    conn.Close();
+    close(fds[1]);
+    std::cout << "✓ 持久注册状态测试通过" << std::endl;
+}
+
 // 测试用户计数
 void testUserCount() {
     std::cout << "测试用户计数..." << std::endl;
@@ -328,6 +484,9 @@ int main() {
         testClose();
         testKeepAlive();
         testToWriteBytes();
+        testDeferredVerify();
+        testMayBlock();
+        testPersistentState();
         testUserCount();
         testStaticVariables();
         
@@ -1,6 +1,8 @@
 
 #include "../http/httprequest.h"
+#include "../pool/sqlconnpool.h"
 #include <iostream>
+#include <cassert>
 
 void TestHttpRequestParse() {
     // 构造一个HTTP POST请求（x-www-form-urlencoded）
@@ -9,7 +11,7 @@ void TestHttpRequestParse() {
         "Host: localhost\r\n"
         "Connection: keep-alive\r\n"
         "Content-Type: application/x-www-form-urlencoded\r\n"
-        "Content-Length: 29\r\n"
+        "Content-Length: 24\r\n"
         "\r\n"
         "username=root&password=1";
 
@@ -38,11 +40,56 @@ void TestHttpRequestParse() {
     }
 }
 
+// 头部字段名大小写不敏感，超长的请求行/头部/请求体分别以 414/431/413 拒绝
+void TestHttpRequestLimits() {
+    {
+        std::string raw = "POST /login HTTP/1.1\r\ncontent-length: 24\r\n"
+                          "CONTENT-TYPE: application/x-www-form-urlencoded\r\n\r\n"
+                          "username=root&password=1";
+        Buffer buffer;
+        buffer.Append(raw.c_str(), raw.size());
+        HttpRequest request;
+        assert(request.parse(buffer));
+        assert(request.GetPost("username") == "root");
+    }
+    {
+        std::string raw = "GET /" + std::string(HttpRequest::MAX_LINE, 'a') + " HTTP/1.1\r\n\r\n";
+        Buffer buffer;
+        buffer.Append(raw.c_str(), raw.size());
+        HttpRequest request;
+        assert(!request.parse(buffer));
+        assert(request.ErrorCode() == 414);
+    }
+    {
+        std::string raw = "GET / HTTP/1.1\r\n";
+        for(int i = 0; i < 8; i++) {
+            raw += "X-Pad" + std::to_string(i) + ": " + std::string(HttpRequest::MAX_HEADER_BYTES / 8, 'b') + "\r\n";
+        }
+        raw += "\r\n";
+        Buffer buffer;
+        buffer.Append(raw.c_str(), raw.size());
+        HttpRequest request;
+        assert(!request.parse(buffer));
+        assert(request.ErrorCode() == 431);
+    }
+    {
+        std::string raw = "POST /login HTTP/1.1\r\nContent-Length: " +
+                          std::to_string(HttpRequest::MAX_BODY + 1) + "\r\n\r\n";
+        Buffer buffer;
+        buffer.Append(raw.c_str(), raw.size());
+        HttpRequest request;
+        assert(!request.parse(buffer));
+        assert(request.ErrorCode() == 413);
+    }
+    std::cout << "✅ 请求大小限制测试通过" << std::endl;
+}
+
 int main() {
     LOG_INFO("./log", 0, 8000, 0); // 初始化日志系统（如有）
     SqlConnPool::Instance()->Init("localhost", 3306, "nieqishuai", "1", "tinyweb", 10); // 初始化连接池
 
     TestHttpRequestParse();
+    TestHttpRequestLimits();
 
     // SqlConnPool::Instance()->ClosePool(); // 释放资源
     return 0;
@@ -34,6 +34,13 @@ public:
 
     void push_front(const T &item);                 //向队列头部添加元素
 
+    bool try_push_back(const T &item);              //非阻塞入队，队列已满或已关闭时返回false
+
+    template<class Pred>
+    bool push_back_evict(const T &item, Pred droppable, T *evicted = nullptr); //非阻塞入队，队列已满时从队头淘汰一个满足droppable的元素，无可淘汰元素时返回false
+
+    void push_back_force(const T &item);            //忽略容量上限强制入队，仅用于不可丢弃的元素
+
     bool pop(T &item);                              //从队列头部弹出元素，如果队列为空则阻塞等待
 
     bool pop(T &item, int timeout);                 //从队列头部弹出元素，如果队列为空则等待指定时间，如果超时则返回false
@@ -132,6 +139,54 @@ void BlockDeque<T>::push_front(const T &item) {
     condConsumer_.notify_one();
 }
 
+template<class T>
+bool BlockDeque<T>::try_push_back(const T &item) {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if(isClose_ || deq_.size() >= capacity_) {
+            return false;
+        }
+        deq_.push_back(item);
+    }
+    condConsumer_.notify_one();
+    return true;
+}
+
+template<class T>
+template<class Pred>
+bool BlockDeque<T>::push_back_evict(const T &item, Pred droppable, T *evicted) {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if(isClose_) {
+            return false;
+        }
+        if(deq_.size() >= capacity_) {
+            auto it = deq_.begin();
+            while(it != deq_.end() && !droppable(*it)) { ++it; }
+            if(it == deq_.end()) {
+                return false;
+            }
+            if(evicted) { *evicted = std::move(*it); }
+            deq_.erase(it);
+        }
+        deq_.push_back(item);
+    }
+    condConsumer_.notify_one();
+    return true;
+}
+
+template<class T>
+void BlockDeque<T>::push_back_force(const T &item) {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if(isClose_) {
+            return;
+        }
+        deq_.push_back(item);
+    }
+    condConsumer_.notify_one();
+}
+
 template<class T>
 bool BlockDeque<T>::empty() {
     std::lock_guard<std::mutex> locker(mtx_);
@@ -1,5 +1,11 @@
 
 #include "log.h"
+#include <spawn.h>      // posix_spawnp
+#include <sys/wait.h>   // waitpid
+#include <fcntl.h>      // O_RDONLY
+#include <unistd.h>     // access
+
+extern char** environ;
 
 using namespace std;
 
@@ -9,7 +15,20 @@ Log::Log() {
     writeThread_ = nullptr;
     deque_ = nullptr;
     toDay_ = 0;
+    fileIndex_ = 0;
+    nextDay_ = 0;
+    fileBytes_ = 0;
+    maxFileBytes_ = 0;
+    compress_ = false;
+    fileName_[0] = '\0';
     fp_ = nullptr;
+    overflowPolicy_ = OVERFLOW_DROP_OLDEST;
+    sampleRate_ = 10;
+    sampleSeq_ = 0;
+    for(int i = 0; i < LEVEL_NUM; i++) {
+        dropCount_[i] = 0;
+    }
+    reportedDrops_ = 0;
 }
 
 Log::~Log() {
@@ -20,11 +39,13 @@ Log::~Log() {
         deque_->Close();
         writeThread_->join();
     }
+    lock_guard<mutex> locker(fileMtx_);
     if(fp_) {
-        lock_guard<mutex> locker(mtx_);
-        flush();
+        fflush(fp_);
         fclose(fp_);
+        fp_ = nullptr;
     }
+    ReapCompressors_(true);
 }
 
 int Log::GetLevel() {
@@ -38,51 +59,149 @@ void Log::SetLevel(int level) {
 }
 
 void Log::init(int level = 1, const char* path, const char* suffix,
-    int maxQueueSize) {
+    int maxQueueSize, int overflowPolicy, int sampleRate,
+    int maxFileMB, bool compress) {
     isOpen_ = true;
     level_ = level;
+    overflowPolicy_ = overflowPolicy;
+    sampleRate_ = sampleRate > 0 ? sampleRate : 1;
+
+    {
+        lock_guard<mutex> locker(mtx_);
+        buff_.RetrieveAll();
+    }
+    {
+        lock_guard<mutex> locker(fileMtx_);
+        path_ = path;
+        suffix_ = suffix;
+        maxFileBytes_ = maxFileMB > 0 ? static_cast<size_t>(maxFileMB) << 20 : 0;
+        compress_ = compress;
+        if(fp_) {
+            fflush(fp_);
+            fclose(fp_);
+            fp_ = nullptr;
+        }
+
+        time_t timer = time(nullptr);
+        struct tm t = *localtime(&timer);
+        OpenFile_(t, 0);
+        assert(fp_ != nullptr);
+    }
+
     if(maxQueueSize > 0) {
-        isAsync_ = true;
         if(!deque_) {
-            unique_ptr<BlockDeque<std::string>> newDeque(new BlockDeque<std::string>);
+            unique_ptr<BlockDeque<LogLine>> newDeque(new BlockDeque<LogLine>(maxQueueSize));
             deque_ = move(newDeque);
             
             std::unique_ptr<std::thread> NewThread(new thread(FlushLogThread));
             writeThread_ = move(NewThread);
         }
+        isAsync_ = true;
     } else {
         isAsync_ = false;
     }
+}
 
+void Log::OpenFile_(const struct tm& t, int index) {
+    while(true) {
+        if(index == 0) {
+            snprintf(fileName_, LOG_NAME_LEN - 1, "%s/%04d_%02d_%02d%s",
+                    path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix_);
+        } else {
+            snprintf(fileName_, LOG_NAME_LEN - 1, "%s/%04d_%02d_%02d-%d%s",
+                    path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, index, suffix_);
+        }
+        /* 压缩时跳过已有.log或.log.gz的序号：同一天重启后序号从0开始，不能追加到之后要压缩、
+           或者覆盖已经压缩好的文件 */
+        if(!compress_ || !FileUsed_(fileName_)) { break; }
+        index++;
+    }
+    fp_ = fopen(fileName_, "a");
+    if(fp_ == nullptr) {
+        mkdir(path_, 0777);
+        fp_ = fopen(fileName_, "a");
+    }
+    toDay_ = t.tm_mday;
+    fileIndex_ = index;
     lineCount_ = 0;
+    fileBytes_ = 0;
+    if(fp_) {
+        /* 追加到已有文件时，从已有大小开始计数 */
+        fseek(fp_, 0, SEEK_END);
+        long size = ftell(fp_);
+        fileBytes_ = size > 0 ? static_cast<size_t>(size) : 0;
+    }
 
-    time_t timer = time(nullptr);
-    struct tm *sysTime = localtime(&timer);
-    struct tm t = *sysTime;
-    path_ = path;
-    suffix_ = suffix;
-    char fileName[LOG_NAME_LEN] = {0};
-    snprintf(fileName, LOG_NAME_LEN - 1, "%s/%04d_%02d_%02d%s", 
-            path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix_);
-    toDay_ = t.tm_mday;
+    /* 计算下一个零点 */
+    struct tm next = t;
+    next.tm_mday += 1;
+    next.tm_hour = next.tm_min = next.tm_sec = 0;
+    next.tm_isdst = -1;
+    nextDay_ = mktime(&next);
+}
 
-    {
-        lock_guard<mutex> locker(mtx_);
-        buff_.RetrieveAll();
-        if(fp_) { 
-            flush();
-            fclose(fp_); 
-        }
+void Log::RotateIfNeeded_(time_t now) {
+    bool newDay = now >= nextDay_;
+    bool full = (lineCount_ >= MAX_LINES) ||
+                (maxFileBytes_ > 0 && fileBytes_ >= maxFileBytes_);
+    if(!newDay && !full) {
+        return;
+    }
 
-        fp_ = fopen(fileName, "a");
-        if(fp_ == nullptr) {
-            mkdir(path_, 0777);
-            fp_ = fopen(fileName, "a");
-        } 
-        assert(fp_ != nullptr);
+    char oldFile[LOG_NAME_LEN];
+    memcpy(oldFile, fileName_, LOG_NAME_LEN);
+    if(fp_) {
+        fflush(fp_);
+        fclose(fp_);
+        fp_ = nullptr;
+    }
+
+    struct tm t = *localtime(&now);
+    OpenFile_(t, newDay ? 0 : fileIndex_ + 1);
+    assert(fp_ != nullptr);
+    if(compress_) {
+        CompressFile_(oldFile);
+    }
+}
+
+bool Log::FileUsed_(const char* fileName) {
+    char gzName[LOG_NAME_LEN + 3];
+    snprintf(gzName, sizeof(gzName), "%s.gz", fileName);
+    return access(fileName, F_OK) == 0 || access(gzName, F_OK) == 0;
+}
+
+void Log::CompressFile_(const char* fileName) {
+    ReapCompressors_(false);
+    /* 不加-f：目标.gz已存在时gzip拒绝覆盖，保留原文件；标准输入接/dev/null，不在终端上询问 */
+    char* const argv[] = { const_cast<char*>("gzip"), const_cast<char*>(fileName), nullptr };
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    pid_t pid;
+    if(posix_spawnp(&pid, "gzip", &actions, nullptr, argv, environ) == 0) {
+        compressPids_.push_back(pid);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+}
+
+void Log::ReapCompressors_(bool wait) {
+    for(auto it = compressPids_.begin(); it != compressPids_.end(); ) {
+        if(waitpid(*it, nullptr, wait ? 0 : WNOHANG) != 0) {
+            it = compressPids_.erase(it);
+        } else {
+            ++it;
+        }
     }
 }
 
+void Log::WriteLine_(const char* line, size_t len) {
+    RotateIfNeeded_(time(nullptr));
+    if(!fp_) { return; }
+    fwrite(line, 1, len, fp_);
+    lineCount_++;
+    fileBytes_ += len;
+}
+
 void Log::write(int level, const char *format, ...) {
     struct timeval now = {0, 0};
     gettimeofday(&now, nullptr);
@@ -91,36 +210,10 @@ void Log::write(int level, const char *format, ...) {
     struct tm t = *sysTime;
     va_list vaList;
 
-    /* 日志日期 日志行数 */
-    if (toDay_ != t.tm_mday || (lineCount_ && (lineCount_  %  MAX_LINES == 0)))
+    LogLine line;
     {
         unique_lock<mutex> locker(mtx_);
-        locker.unlock();
-        
-        char newFile[LOG_NAME_LEN];
-        char tail[36] = {0};
-        snprintf(tail, 36, "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
-
-        if (toDay_ != t.tm_mday)
-        {
-            snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s%s", path_, tail, suffix_);
-            toDay_ = t.tm_mday;
-            lineCount_ = 0;
-        }
-        else {
-            snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s-%d%s", path_, tail, (lineCount_  / MAX_LINES), suffix_);
-        }
-        
-        locker.lock();
-        flush();
-        fclose(fp_);
-        fp_ = fopen(newFile, "a");
-        assert(fp_ != nullptr);
-    }
-
-    {
-        unique_lock<mutex> locker(mtx_);
-        lineCount_++;
+        buff_.EnsureWriteable(128);
         int n = snprintf(buff_.BeginWrite(), 128, "%d-%02d-%02d %02d:%02d:%02d.%06ld ",
                     t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
                     t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
@@ -131,17 +224,85 @@ void Log::write(int level, const char *format, ...) {
         va_start(vaList, format);
         int m = vsnprintf(buff_.BeginWrite(), buff_.WritableBytes(), format, vaList);
         va_end(vaList);
+        if(m >= 0 && static_cast<size_t>(m) >= buff_.WritableBytes()) {
+            /* 超长日志：扩容后重新格式化，避免越界 */
+            buff_.EnsureWriteable(m + 1);
+            va_start(vaList, format);
+            m = vsnprintf(buff_.BeginWrite(), buff_.WritableBytes(), format, vaList);
+            va_end(vaList);
+        }
 
         buff_.HasWritten(m);
-        buff_.Append("\n\0", 2);
+        buff_.Append("\n", 1);
 
-        if(isAsync_ && deque_ && !deque_->full()) {
-            deque_->push_back(buff_.RetrieveAllToStr());
-        } else {
-            fputs(buff_.Peek(), fp_);
+        if(!isAsync_ || !deque_) {
+            /* 同步模式：无写线程，在当前线程写入并轮转 */
+            lock_guard<mutex> fileLocker(fileMtx_);
+            WriteLine_(buff_.Peek(), buff_.ReadableBytes());
+            buff_.RetrieveAll();
+            return;
         }
-        buff_.RetrieveAll();
+        line.level = level;
+        line.text = buff_.RetrieveAllToStr();
     }
+    /* 入队不持有mtx_，避免与写线程互相等待 */
+    PushAsync_(line);
+}
+
+void Log::PushAsync_(const LogLine& line) {
+    bool critical = line.level >= NEVER_DROP_LEVEL;
+    switch(overflowPolicy_) {
+    case OVERFLOW_BLOCK:
+        deque_->push_back(line);
+        return;
+    case OVERFLOW_DROP_NEWEST:
+        if(deque_->try_push_back(line)) { return; }
+        if(!critical) {
+            CountDrop_(line.level);
+            return;
+        }
+        break;
+    case OVERFLOW_SAMPLE:
+        if(deque_->try_push_back(line)) { return; }
+        if(!critical && sampleSeq_++ % sampleRate_ != 0) {
+            CountDrop_(line.level);
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+
+    /* 淘汰队列中最旧的可丢弃日志为新日志腾出位置 */
+    LogLine evicted = { -1, "" };
+    if(deque_->push_back_evict(line, [](const LogLine& item) {
+                return item.level < NEVER_DROP_LEVEL;
+            }, &evicted)) {
+        if(evicted.level >= 0) { CountDrop_(evicted.level); }
+        return;
+    }
+    /* 队列中全是不可丢弃的日志 */
+    if(critical) {
+        deque_->push_back_force(line);
+    } else {
+        CountDrop_(line.level);
+    }
+}
+
+void Log::CountDrop_(int level) {
+    if(level < 0 || level >= LEVEL_NUM) { level = 1; }
+    dropCount_[level]++;
+}
+
+uint64_t Log::GetDropCount(int level) const {
+    if(level >= 0 && level < LEVEL_NUM) {
+        return dropCount_[level];
+    }
+    uint64_t total = 0;
+    for(int i = 0; i < LEVEL_NUM; i++) {
+        total += dropCount_[i];
+    }
+    return total;
 }
 
 void Log::AppendLogLevelTitle_(int level) {
@@ -166,16 +327,28 @@ void Log::AppendLogLevelTitle_(int level) {
 
 void Log::flush() {
     if(isAsync_) { 
+        /* 唤醒写线程，由写线程在队列排空时刷盘 */
         deque_->flush(); 
+        return;
     }
-    fflush(fp_);
+    lock_guard<mutex> locker(fileMtx_);
+    if(fp_) { fflush(fp_); }
 }
 
 void Log::AsyncWrite_() {
-    string str = "";
-    while(deque_->pop(str)) {
-        lock_guard<mutex> locker(mtx_);
-        fputs(str.c_str(), fp_);
+    LogLine line;
+    while(deque_->pop(line)) {
+        lock_guard<mutex> locker(fileMtx_);
+        WriteLine_(line.text.data(), line.text.size());
+        uint64_t dropped = GetDropCount();
+        if(dropped != reportedDrops_ && fp_) {
+            fileBytes_ += fprintf(fp_, "[warn] : log queue overflow, %llu lines dropped in total\n",
+                    static_cast<unsigned long long>(dropped));
+            reportedDrops_ = dropped;
+        }
+        if(deque_->empty() && fp_) {
+            fflush(fp_);
+        }
     }
 }
 
@@ -3,6 +3,7 @@
 #define LOG_H
 
 #include <mutex>
+#include <atomic>
 #include <string>
 #include <thread>
 #include <sys/time.h>
@@ -10,14 +11,33 @@
 #include <stdarg.h>           // vastart va_end
 #include <assert.h>
 #include <sys/stat.h>         //mkdir
+#include <vector>
 #include "blockqueue.h"
 #include "../buffer/buffer.h"
 
+/* 异步队列中的一条日志，携带等级以便溢出时按优先级淘汰 */
+struct LogLine {
+    int level;
+    std::string text;
+};
+
 class Log {
 public:
+    /* 异步队列已满时的处理策略 */
+    enum OVERFLOW_POLICY {
+        OVERFLOW_BLOCK = 0,         ///< 阻塞等待队列空位
+        OVERFLOW_DROP_NEWEST,       ///< 丢弃新日志
+        OVERFLOW_DROP_OLDEST,       ///< 淘汰队列中最旧的可丢弃日志
+        OVERFLOW_SAMPLE,            ///< 每 sampleRate 条新日志保留一条，其余丢弃
+    };
+
     void init(int level, const char* path = "./log", 
                 const char* suffix =".log",
-                int maxQueueCapacity = 1024);
+                int maxQueueCapacity = 1024,
+                int overflowPolicy = OVERFLOW_DROP_OLDEST,
+                int sampleRate = 10,
+                int maxFileMB = 0,
+                bool compress = false);
 
     static Log* Instance();     
     static void FlushLogThread();
@@ -28,17 +48,31 @@ public:
     int GetLevel();
     void SetLevel(int level);
     bool IsOpen() { return isOpen_; }
+
+    uint64_t GetDropCount(int level = -1) const;   // 因队列溢出丢弃的日志条数，level为-1时返回总数
     
 private:
     Log();
     void AppendLogLevelTitle_(int level);
     virtual ~Log();
     void AsyncWrite_();
+    void PushAsync_(const LogLine& line);         // 按溢出策略投递到异步队列，不会持有mtx_
+    void CountDrop_(int level);
+
+    /* 以下函数需持有fileMtx_，异步模式下只在写线程中调用 */
+    void WriteLine_(const char* line, size_t len);  // 写入一行，必要时先轮转文件
+    void RotateIfNeeded_(time_t now);               // 按日期、行数、字节数判断是否轮转
+    void OpenFile_(const struct tm& t, int index);  // 打开指定日期和序号的日志文件
+    void CompressFile_(const char* fileName);       // 后台gzip压缩已轮转的文件
+    static bool FileUsed_(const char* fileName);    // 该日志文件或其压缩文件已存在
+    void ReapCompressors_(bool wait);               // 回收压缩子进程
 
 private:
     static const int LOG_PATH_LEN = 256;
     static const int LOG_NAME_LEN = 256;
     static const int MAX_LINES = 50000;
+    static const int LEVEL_NUM = 4;
+    static const int NEVER_DROP_LEVEL = 3;      // 不低于该等级(ERROR)的日志永不丢弃
 
     const char* path_;
     const char* suffix_;
@@ -47,17 +81,30 @@ private:
 
     int lineCount_;
     int toDay_;
+    int fileIndex_;                 // 当天按行数/大小切分的文件序号
+    time_t nextDay_;                // 下一次按日期轮转的时间点
+    size_t fileBytes_;              // 当前文件已写入的字节数
+    size_t maxFileBytes_;           // 单个文件的字节上限，0表示不限制
+    bool compress_;                 // 是否压缩轮转下来的文件
+    char fileName_[LOG_NAME_LEN];   // 当前文件名
+    std::vector<pid_t> compressPids_;
 
     bool isOpen_;
  
     Buffer buff_;
     int level_;
     bool isAsync_;
+    int overflowPolicy_;
+    int sampleRate_;
+    std::atomic<uint64_t> sampleSeq_;
+    std::atomic<uint64_t> dropCount_[LEVEL_NUM];
+    uint64_t reportedDrops_;                    // 写线程已报告过的丢弃总数
 
     FILE* fp_;
-    std::unique_ptr<BlockDeque<std::string>> deque_; 
+    std::unique_ptr<BlockDeque<LogLine>> deque_; 
     std::unique_ptr<std::thread> writeThread_;
-    std::mutex mtx_;
+    std::mutex mtx_;                // 保护buff_与level_
+    std::mutex fileMtx_;            // 保护fp_与轮转状态，写线程轮转时不阻塞请求线程
 };
 
 #define LOG_BASE(level, format, ...) \
@@ -1,6 +1,8 @@
 #include "log.h"
 #include <thread>
 #include <chrono>
+#include <iostream>
+#include <cassert>
 
 void WriteSampleLogs(int threadId) {
     for(int i = 0; i < 100; ++i) {
@@ -12,7 +14,32 @@ void WriteSampleLogs(int threadId) {
     }
 }
 
+// 测试队列满时的非阻塞入队与按优先级淘汰
+void TestBlockDequeOverflow() {
+    BlockDeque<LogLine> deq(2);
+    assert(deq.try_push_back({3, "error-1"}));
+    assert(deq.try_push_back({1, "info-1"}));
+    assert(!deq.try_push_back({1, "info-2"}));
+
+    auto droppable = [](const LogLine& item) { return item.level < 3; };
+    LogLine evicted = { -1, "" };
+    assert(deq.push_back_evict({3, "error-2"}, droppable, &evicted));
+    assert(evicted.text == "info-1");
+    assert(deq.size() == 2);
+
+    /* 队列中只剩ERROR，无法淘汰 */
+    assert(!deq.push_back_evict({3, "error-3"}, droppable));
+    deq.push_back_force({3, "error-3"});
+    assert(deq.size() == 3);
+
+    LogLine line;
+    assert(deq.pop(line) && line.text == "error-1");
+    std::cout << "BlockDeque overflow test passed" << std::endl;
+}
+
 int main() {
+    TestBlockDequeOverflow();
+
     // 初始化日志系统（异步模式，日志等级设为0：DEBUG）
     Log::Instance()->init(3, "./log_test", ".log", 1024);
 
@@ -27,6 +54,7 @@ int main() {
 
     // 等待异步日志线程写完所有日志
     Log::Instance()->flush();
+    std::cout << "dropped lines: " << Log::Instance()->GetDropCount() << std::endl;
 
     return 0;
 }
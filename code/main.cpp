@@ -27,6 +27,31 @@ int main() {
         bool openLog = true;
         int logLevel = 1;
         int logQueSize = 1024;
+        int logOverflow = Log::OVERFLOW_DROP_OLDEST;
+        int logSampleRate = 10;
+        int logMaxFileMB = 0;
+        bool logCompress = false;
+
+        std::string metricsPath;
+        int metricsPort = 0;
+        int slowRequestMs = 0;
+        int bufferMode = 0;
+        int idleBufferKB = -1;
+        int sqlThreadNum = 0;
+        int sqlMinConn = -1;
+        int sqlAcquireTimeoutMs = 1000;
+        int sqlReadyConn = -1;
+        int userCacheTtlS = 0;
+        int hashThreadNum = 0;
+        int pwdHashIterations = 0;
+        int registerBatchMs = 0;
+        int registerBatchRows = 64;
+        int inlineMaxKB = 0;
+        int preallocConns = 0;
+        int deferAcceptS = 0;
+        int fastOpenQueue = 0;
+        std::string userStore = "mysql";
+        std::string userStorePath = "./users.db";
 
         // 尝试从配置文件读取值
         std::string portStr = config.Get("port");
@@ -94,6 +119,126 @@ int main() {
             logQueSize = std::stoi(logQueSizeStr);
         }
 
+        std::string logOverflowStr = config.Get("logOverflow");
+        if (!logOverflowStr.empty()) {
+            logOverflow = std::stoi(logOverflowStr);
+        }
+
+        std::string logSampleRateStr = config.Get("logSampleRate");
+        if (!logSampleRateStr.empty()) {
+            logSampleRate = std::stoi(logSampleRateStr);
+        }
+
+        std::string logMaxFileMBStr = config.Get("logMaxFileMB");
+        if (!logMaxFileMBStr.empty()) {
+            logMaxFileMB = std::stoi(logMaxFileMBStr);
+        }
+
+        std::string logCompressStr = config.Get("logCompress");
+        if (!logCompressStr.empty()) {
+            logCompress = (logCompressStr == "true" || logCompressStr == "1");
+        }
+
+        std::string metricsPathStr = config.Get("metricsPath");
+        if (!metricsPathStr.empty()) {
+            metricsPath = (metricsPathStr == "off") ? "" : metricsPathStr;
+        }
+
+        std::string metricsPortStr = config.Get("metricsPort");
+        if (!metricsPortStr.empty()) {
+            metricsPort = std::stoi(metricsPortStr);
+        }
+
+        std::string slowRequestMsStr = config.Get("slowRequestMs");
+        if (!slowRequestMsStr.empty()) {
+            slowRequestMs = std::stoi(slowRequestMsStr);
+        }
+
+        std::string bufferModeStr = config.Get("bufferMode");
+        if (!bufferModeStr.empty()) {
+            bufferMode = std::stoi(bufferModeStr);
+        }
+
+        std::string idleBufferKBStr = config.Get("idleBufferKB");
+        if (!idleBufferKBStr.empty()) {
+            idleBufferKB = std::stoi(idleBufferKBStr);
+        }
+
+        std::string sqlThreadNumStr = config.Get("sqlThreadNum");
+        if (!sqlThreadNumStr.empty()) {
+            sqlThreadNum = std::stoi(sqlThreadNumStr);
+        }
+
+        std::string sqlMinConnStr = config.Get("sqlMinConn");
+        if (!sqlMinConnStr.empty()) {
+            sqlMinConn = std::stoi(sqlMinConnStr);
+        }
+
+        std::string sqlAcquireTimeoutMsStr = config.Get("sqlAcquireTimeoutMs");
+        if (!sqlAcquireTimeoutMsStr.empty()) {
+            sqlAcquireTimeoutMs = std::stoi(sqlAcquireTimeoutMsStr);
+        }
+
+        std::string sqlReadyConnStr = config.Get("sqlReadyConn");
+        if (!sqlReadyConnStr.empty()) {
+            sqlReadyConn = std::stoi(sqlReadyConnStr);
+        }
+
+        std::string hashThreadNumStr = config.Get("hashThreadNum");
+        if (!hashThreadNumStr.empty()) {
+            hashThreadNum = std::stoi(hashThreadNumStr);
+        }
+
+        std::string pwdHashIterationsStr = config.Get("pwdHashIterations");
+        if (!pwdHashIterationsStr.empty()) {
+            pwdHashIterations = std::stoi(pwdHashIterationsStr);
+        }
+
+        std::string registerBatchMsStr = config.Get("registerBatchMs");
+        if (!registerBatchMsStr.empty()) {
+            registerBatchMs = std::stoi(registerBatchMsStr);
+        }
+
+        std::string registerBatchRowsStr = config.Get("registerBatchRows");
+        if (!registerBatchRowsStr.empty()) {
+            registerBatchRows = std::stoi(registerBatchRowsStr);
+        }
+
+        std::string userCacheTtlSStr = config.Get("userCacheTtlS");
+        if (!userCacheTtlSStr.empty()) {
+            userCacheTtlS = std::stoi(userCacheTtlSStr);
+        }
+
+        std::string inlineMaxKBStr = config.Get("inlineMaxKB");
+        if (!inlineMaxKBStr.empty()) {
+            inlineMaxKB = std::stoi(inlineMaxKBStr);
+        }
+
+        std::string preallocConnsStr = config.Get("preallocConns");
+        if (!preallocConnsStr.empty()) {
+            preallocConns = std::stoi(preallocConnsStr);
+        }
+
+        std::string deferAcceptSStr = config.Get("deferAcceptS");
+        if (!deferAcceptSStr.empty()) {
+            deferAcceptS = std::stoi(deferAcceptSStr);
+        }
+
+        std::string fastOpenQueueStr = config.Get("fastOpenQueue");
+        if (!fastOpenQueueStr.empty()) {
+            fastOpenQueue = std::stoi(fastOpenQueueStr);
+        }
+
+        std::string userStoreStr = config.Get("userStore");
+        if (!userStoreStr.empty()) {
+            userStore = userStoreStr;
+        }
+
+        std::string userStorePathStr = config.Get("userStorePath");
+        if (!userStorePathStr.empty()) {
+            userStorePath = userStorePathStr;
+        }
+
         // 输出配置信息
         std::cout << "=== Web服务器配置 ===" << std::endl;
         std::cout << "端口: " << port << std::endl;
@@ -104,17 +249,53 @@ int main() {
         std::cout << "数据库用户: " << sqlUser << std::endl;
         std::cout << "数据库名: " << dbName << std::endl;
         std::cout << "连接池数量: " << connPoolNum << std::endl;
+        std::cout << "连接池最少连接: " << (sqlMinConn < 0 ? connPoolNum : sqlMinConn) << std::endl;
+        std::cout << "获取连接超时: " << sqlAcquireTimeoutMs << "ms" << std::endl;
+        std::cout << "启动就绪连接: " << (sqlReadyConn < 0 ? std::string("全部") : std::to_string(sqlReadyConn)) << std::endl;
         std::cout << "线程池数量: " << threadNum << std::endl;
         std::cout << "日志开关: " << (openLog ? "开启" : "关闭") << std::endl;
         std::cout << "日志等级: " << logLevel << std::endl;
         std::cout << "日志队列容量: " << logQueSize << std::endl;
+        std::cout << "日志溢出策略: " << logOverflow << std::endl;
+        std::cout << "日志文件上限: " << logMaxFileMB << "MB" << std::endl;
+        std::cout << "日志压缩: " << (logCompress ? "开启" : "关闭") << std::endl;
+        std::cout << "指标路径: " << (metricsPath.empty() ? "关闭" : metricsPath) << std::endl;
+        std::cout << "指标端口: " << metricsPort << std::endl;
+        std::cout << "慢请求阈值: " << slowRequestMs << "ms" << std::endl;
+        std::cout << "缓冲区: " << (bufferMode == 1 ? "环形" : (bufferMode == 2 ? "分块链" : "连续数组")) << std::endl;
+        std::cout << "反应堆线程内联处理: " << (inlineMaxKB > 0 ? "响应不超过" + std::to_string(inlineMaxKB) + "KB" : "关闭") << std::endl;
+        std::cout << "延迟accept: " << (deferAcceptS > 0 ? std::to_string(deferAcceptS) + "s" : "关闭") << std::endl;
+        std::cout << "TCP Fast Open队列: " << (fastOpenQueue > 0 ? std::to_string(fastOpenQueue) : "关闭") << std::endl;
+        std::cout << "预分配连接槽: " << (preallocConns > 0 ? std::to_string(preallocConns) : "按需分配") << std::endl;
+        std::cout << "空闲缓冲区上限: " << (idleBufferKB < 0 ? "不释放" : std::to_string(idleBufferKB) + "KB") << std::endl;
+        std::cout << "SQL线程数: " << (sqlThreadNum > 0 ? std::to_string(sqlThreadNum) : "0(工作线程同步验证)") << std::endl;
+        std::cout << "口令哈希线程数: " << hashThreadNum << std::endl;
+        std::cout << "口令哈希迭代次数: " << (pwdHashIterations > 0 ? std::to_string(pwdHashIterations) : "0(明文)") << std::endl;
+        std::cout << "注册批量写入: " << (registerBatchMs > 0 && sqlThreadNum > 0 ? std::to_string(registerBatchMs) + "ms/" + std::to_string(registerBatchRows) + "行" : "关闭") << std::endl;
+        std::cout << "用户存储: " << userStore << (userStore == "sqlite" ? " " + userStorePath : "") << std::endl;
+        std::cout << "登录缓存有效期: " << (userCacheTtlS > 0 ? std::to_string(userCacheTtlS) + "s" : "关闭") << std::endl;
         std::cout << "====================" << std::endl;
 
         WebServer server(
             port, mode, timeout, optLinger,              /* 端口 ET模式 timeoutMs 优雅退出  */
             sqlPort, sqlUser.c_str(), sqlPwd.c_str(), dbName.c_str(),     /* Mysql配置 */
             connPoolNum, threadNum, openLog, logLevel,                /* 连接池数量 线程池数量 日志开关 日志等级  */
-            logQueSize);             /* 日志异步队列容量 */
+            logQueSize, logOverflow, logSampleRate,    /* 日志异步队列容量 溢出策略 采样间隔 */
+            logMaxFileMB, logCompress,                 /* 日志文件大小上限 轮转后压缩 */
+            metricsPath.c_str(), metricsPort,          /* 指标路径 管理端口(0为共用业务端口) */
+            slowRequestMs,                             /* 慢请求日志阈值 */
+            bufferMode,                                /* 缓冲区 0连续数组 1环形 2分块链 */
+            idleBufferKB,                              /* 空闲连接保留的缓冲区上限(KB)，-1不释放 */
+            sqlThreadNum,                              /* 执行用户验证的SQL线程数，0为在工作线程上同步验证 */
+            sqlMinConn, sqlAcquireTimeoutMs,           /* 连接池最少连接数(-1同上限) 获取连接超时(ms) */
+            sqlReadyConn,                              /* 启动时就绪多少个连接即开始服务(-1为全部) */
+            userCacheTtlS,                             /* 登录结果缓存有效期(秒)，0为关闭 */
+            hashThreadNum, pwdHashIterations,          /* 口令哈希线程数 迭代次数(0为明文) */
+            registerBatchMs, registerBatchRows,        /* 注册攒批的最长等待(ms，0为关闭) 每批行数上限 */
+            userStore.c_str(), userStorePath.c_str(),  /* 用户存储 mysql/sqlite/memory SQLite文件路径 */
+            inlineMaxKB,                               /* 反应堆线程直接处理请求、写出不超过该值(KB)的响应，0为关闭 */
+            preallocConns,                             /* 启动时预分配的连接槽数，0为按需分配 */
+            deferAcceptS, fastOpenQueue);              /* 延迟accept等待(秒) TCP Fast Open队列长度，0为关闭 */
         server.Start();
         
     } catch (const std::exception& e) {
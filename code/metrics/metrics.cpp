@@ -0,0 +1,262 @@
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+using namespace std;
+
+const char* Metrics::COUNTER_NAME[COUNTER_NUM] = {
+    "webserver_accepts_total",
+    "webserver_http_bytes_received_total",
+    "webserver_http_bytes_sent_total",
+};
+
+const char* Metrics::COUNTER_HELP[COUNTER_NUM] = {
+    "Accepted client connections.",
+    "Bytes read from clients.",
+    "Bytes written to clients.",
+};
+
+const char* Metrics::HISTOGRAM_NAME[HISTOGRAM_NUM] = {
+    "webserver_http_request_duration_seconds",
+    "webserver_stage_accept_to_read_seconds",
+    "webserver_stage_read_to_parse_seconds",
+    "webserver_stage_parse_to_build_seconds",
+    "webserver_stage_build_to_write_seconds",
+    "webserver_stage_queue_wait_seconds",
+    "webserver_sql_verify_duration_seconds",
+    "webserver_sql_acquire_duration_seconds",
+    "webserver_password_hash_queue_wait_seconds",
+    "webserver_password_hash_duration_seconds",
+};
+
+const char* Metrics::HISTOGRAM_HELP[HISTOGRAM_NUM] = {
+    "Time from the first request byte read to the last response byte written.",
+    "Time from accept to the first byte read, first request on a connection only.",
+    "Time from the first request byte read to parse complete.",
+    "Time from parse complete to response built.",
+    "Time from response built to the last byte written.",
+    "Time a request spent waiting in the thread pool queue.",
+    "Time from submitting a user verification to the SQL executor to its result.",
+    "Time spent acquiring a connection from the SQL pool.",
+    "Time a password hash waited for a hash thread.",
+    "Time spent computing a password hash.",
+};
+
+Histogram::Histogram() : sum_(0) {
+    for(int i = 0; i < BUCKET_NUM; i++) {
+        counts_[i].store(0, memory_order_relaxed);
+    }
+}
+
+int Histogram::BucketIndex(uint64_t value) {
+    if(value < static_cast<uint64_t>(SUB_BUCKETS)) {
+        return static_cast<int>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    if(msb >= MAX_BITS) {
+        return BUCKET_NUM - 1;
+    }
+    int shift = msb - SUB_BITS;
+    int block = msb - SUB_BITS + 1;
+    int sub = static_cast<int>(value >> shift) - SUB_BUCKETS;
+    return block * SUB_BUCKETS + sub;
+}
+
+uint64_t Histogram::BucketUpper(int index) {
+    int block = index / SUB_BUCKETS;
+    uint64_t sub = index % SUB_BUCKETS;
+    if(block == 0) {
+        return sub + 1;
+    }
+    int shift = block - 1;
+    return (static_cast<uint64_t>(SUB_BUCKETS) + sub + 1) << shift;
+}
+
+uint64_t Histogram::Percentile(const vector<uint64_t>& counts, double p) {
+    uint64_t total = 0;
+    for(size_t i = 0; i < counts.size(); i++) {
+        total += counts[i];
+    }
+    if(total == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(p * total + 0.5);
+    if(rank == 0) { rank = 1; }
+    uint64_t seen = 0;
+    for(size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if(seen >= rank) {
+            return BucketUpper(static_cast<int>(i));
+        }
+    }
+    return BucketUpper(static_cast<int>(counts.size()) - 1);
+}
+
+void Histogram::Record(uint64_t value) {
+    /* 单写者：普通的读-改-写即可，避免加锁前缀指令 */
+    std::atomic<uint64_t>& c = counts_[BucketIndex(value)];
+    c.store(c.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    sum_.store(sum_.load(memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+void Histogram::MergeTo(vector<uint64_t>& counts, uint64_t& sum) const {
+    if(counts.size() < static_cast<size_t>(BUCKET_NUM)) {
+        counts.resize(BUCKET_NUM, 0);
+    }
+    for(int i = 0; i < BUCKET_NUM; i++) {
+        counts[i] += counts_[i].load(memory_order_relaxed);
+    }
+    sum += sum_.load(memory_order_relaxed);
+}
+
+Metrics::Shard::Shard() {
+    for(int i = 0; i < COUNTER_NUM; i++) {
+        counters[i].store(0, memory_order_relaxed);
+    }
+    for(int i = 0; i < STATUS_NUM; i++) {
+        status[i].store(0, memory_order_relaxed);
+    }
+}
+
+Metrics* Metrics::Instance() {
+    static Metrics inst;
+    return &inst;
+}
+
+Metrics::Shard* Metrics::LocalShard_() {
+    static thread_local Shard* shard = nullptr;
+    if(!shard) {
+        void* mem = nullptr;
+        if(posix_memalign(&mem, 64, sizeof(Shard)) != 0) {
+            throw bad_alloc();
+        }
+        shard = new(mem) Shard();
+        lock_guard<mutex> locker(mtx_);
+        shards_.push_back(shard);
+    }
+    return shard;
+}
+
+void Metrics::Add(COUNTER counter, uint64_t n) {
+    std::atomic<uint64_t>& c = LocalShard_()->counters[counter];
+    c.store(c.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+void Metrics::CountStatus(int code) {
+    if(code < STATUS_MIN || code >= STATUS_MIN + STATUS_NUM) {
+        return;
+    }
+    std::atomic<uint64_t>& c = LocalShard_()->status[code - STATUS_MIN];
+    c.store(c.load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+void Metrics::Observe(HISTOGRAM hist, uint64_t us) {
+    LocalShard_()->hists[hist].Record(us);
+}
+
+void Metrics::RegisterGauge(const string& name, const string& help,
+                            const function<double()>& fn, bool isCounter) {
+    lock_guard<mutex> locker(mtx_);
+    for(auto& g : gauges_) {
+        if(g.name == name) {
+            g.help = help;
+            g.fn = fn;
+            g.isCounter = isCounter;
+            return;
+        }
+    }
+    gauges_.push_back({name, help, fn, isCounter});
+}
+
+uint64_t Metrics::GetCounter(COUNTER counter) {
+    lock_guard<mutex> locker(mtx_);
+    uint64_t total = 0;
+    for(auto shard : shards_) {
+        total += shard->counters[counter].load(memory_order_relaxed);
+    }
+    return total;
+}
+
+void Metrics::GetHistogram(HISTOGRAM hist, vector<uint64_t>& counts, uint64_t& sum) {
+    counts.assign(Histogram::BUCKET_NUM, 0);
+    sum = 0;
+    lock_guard<mutex> locker(mtx_);
+    for(auto shard : shards_) {
+        shard->hists[hist].MergeTo(counts, sum);
+    }
+}
+
+string Metrics::Scrape() {
+    uint64_t counters[COUNTER_NUM] = { 0 };
+    vector<uint64_t> status(STATUS_NUM, 0);
+    vector<vector<uint64_t>> hists(HISTOGRAM_NUM, vector<uint64_t>(Histogram::BUCKET_NUM, 0));
+    vector<uint64_t> sums(HISTOGRAM_NUM, 0);
+    vector<Gauge> gauges;
+    {
+        lock_guard<mutex> locker(mtx_);
+        for(auto shard : shards_) {
+            for(int i = 0; i < COUNTER_NUM; i++) {
+                counters[i] += shard->counters[i].load(memory_order_relaxed);
+            }
+            for(int i = 0; i < STATUS_NUM; i++) {
+                status[i] += shard->status[i].load(memory_order_relaxed);
+            }
+            for(int i = 0; i < HISTOGRAM_NUM; i++) {
+                shard->hists[i].MergeTo(hists[i], sums[i]);
+            }
+        }
+        gauges = gauges_;
+    }
+
+    string out;
+    char line[256];
+    out += "# HELP webserver_http_requests_total HTTP responses by status code.\n";
+    out += "# TYPE webserver_http_requests_total counter\n";
+    for(int i = 0; i < STATUS_NUM; i++) {
+        if(status[i] == 0) { continue; }
+        snprintf(line, sizeof(line), "webserver_http_requests_total{code=\"%d\"} %llu\n",
+                 i + STATUS_MIN, static_cast<unsigned long long>(status[i]));
+        out += line;
+    }
+
+    for(int i = 0; i < COUNTER_NUM; i++) {
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s counter\n%s %llu\n",
+                 COUNTER_NAME[i], COUNTER_HELP[i], COUNTER_NAME[i], COUNTER_NAME[i],
+                 static_cast<unsigned long long>(counters[i]));
+        out += line;
+    }
+
+    for(auto& g : gauges) {
+        out += "# HELP " + g.name + " " + g.help + "\n";
+        out += "# TYPE " + g.name + (g.isCounter ? " counter\n" : " gauge\n");
+        snprintf(line, sizeof(line), "%s %.17g\n", g.name.c_str(), g.fn ? g.fn() : 0.0);
+        out += line;
+    }
+
+    /* 直方图按2的幂边界导出累计桶，单位秒 */
+    for(int h = 0; h < HISTOGRAM_NUM; h++) {
+        const char* name = HISTOGRAM_NAME[h];
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s histogram\n",
+                 name, HISTOGRAM_HELP[h], name);
+        out += line;
+        uint64_t cumulative = 0;
+        uint64_t total = 0;
+        for(int i = 0; i < Histogram::BUCKET_NUM; i++) {
+            total += hists[h][i];
+        }
+        for(int i = 0; i < Histogram::BUCKET_NUM; i++) {
+            cumulative += hists[h][i];
+            if(i % Histogram::SUB_BUCKETS != Histogram::SUB_BUCKETS - 1) { continue; }
+            snprintf(line, sizeof(line), "%s_bucket{le=\"%g\"} %llu\n", name,
+                     Histogram::BucketUpper(i) / 1e6, static_cast<unsigned long long>(cumulative));
+            out += line;
+        }
+        snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %g\n%s_count %llu\n",
+                 name, static_cast<unsigned long long>(total),
+                 name, sums[h] / 1e6,
+                 name, static_cast<unsigned long long>(total));
+        out += line;
+    }
+    return out;
+}
@@ -0,0 +1,110 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+
+/*
+ * HDR风格的对数-线性直方图（单位：微秒）
+ * 每个2的幂区间再均分为 SUB_BUCKETS 个子桶，相对误差不超过 1/SUB_BUCKETS
+ * 只允许一个线程写入，其他线程可随时读取（relaxed原子读写，无锁无RMW）
+ */
+class Histogram {
+public:
+    static const int SUB_BITS = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int MAX_BITS = 40;                  // 最大可记录约 2^40us
+    static const int BUCKET_NUM = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+    Histogram();
+
+    void Record(uint64_t value);                     // 记录一个样本（仅由所属线程调用）
+    void MergeTo(std::vector<uint64_t>& counts, uint64_t& sum) const;  // 累加到counts/sum
+
+    static int BucketIndex(uint64_t value);          // 样本所在桶的下标
+    static uint64_t BucketUpper(int index);          // 桶的上界（不含）
+    static uint64_t Percentile(const std::vector<uint64_t>& counts, double p);  // 从桶计数估算分位数
+
+private:
+    std::atomic<uint64_t> counts_[BUCKET_NUM];
+    std::atomic<uint64_t> sum_;
+};
+
+class Metrics {
+public:
+    enum COUNTER {
+        ACCEPTS = 0,        ///< 接受的连接数
+        BYTES_IN,           ///< 从客户端读取的字节数
+        BYTES_OUT,          ///< 写给客户端的字节数
+        COUNTER_NUM,
+    };
+
+    enum HISTOGRAM {
+        REQUEST_LATENCY = 0,    ///< 读到请求首字节到响应写完的耗时
+        STAGE_ACCEPT_TO_READ,   ///< 连接建立到读到首字节（仅连接上的第一个请求）
+        STAGE_READ_TO_PARSE,    ///< 读到首字节到解析完成
+        STAGE_PARSE_TO_BUILD,   ///< 解析完成到响应构建完成
+        STAGE_BUILD_TO_WRITE,   ///< 响应构建完成到最后一个字节写出
+        STAGE_QUEUE_WAIT,       ///< 请求在线程池队列中的累计等待
+        SQL_VERIFY,             ///< 用户验证提交到SQL线程至得到结果（含排队）
+        SQL_ACQUIRE,            ///< 从数据库连接池获取连接的等待
+        HASH_QUEUE_WAIT,        ///< 口令哈希在哈希线程队列中的等待
+        HASH_DURATION,          ///< 口令哈希的计算耗时
+        HISTOGRAM_NUM,
+    };
+
+    static Metrics* Instance();
+
+    /* 以下计数接口写入调用线程自己的分片，不产生跨线程竞争 */
+    void Add(COUNTER counter, uint64_t n = 1);
+    void CountStatus(int code);                         // 按HTTP状态码计数
+    void Observe(HISTOGRAM hist, uint64_t us);          // 记录耗时样本（微秒）
+
+    /* 注册在抓取时才求值的指标，isCounter为true时按counter类型导出 */
+    void RegisterGauge(const std::string& name, const std::string& help,
+                       const std::function<double()>& fn, bool isCounter = false);
+
+    uint64_t GetCounter(COUNTER counter);               // 聚合所有分片的计数
+    void GetHistogram(HISTOGRAM hist, std::vector<uint64_t>& counts, uint64_t& sum);
+
+    std::string Scrape();                               // 聚合并生成Prometheus文本格式
+
+private:
+    Metrics() = default;
+    ~Metrics() = default;
+
+    static const int STATUS_MIN = 100;
+    static const int STATUS_NUM = 500;                  // 状态码 100~599
+
+    /* 每个线程独占一个分片，按缓存行对齐避免伪共享 */
+    struct alignas(64) Shard {
+        Shard();
+        std::atomic<uint64_t> counters[COUNTER_NUM];
+        std::atomic<uint64_t> status[STATUS_NUM];
+        Histogram hists[HISTOGRAM_NUM];
+    };
+
+    struct Gauge {
+        std::string name;
+        std::string help;
+        std::function<double()> fn;
+        bool isCounter;
+    };
+
+    Shard* LocalShard_();
+
+    static const char* COUNTER_NAME[COUNTER_NUM];
+    static const char* COUNTER_HELP[COUNTER_NUM];
+    static const char* HISTOGRAM_NAME[HISTOGRAM_NUM];
+    static const char* HISTOGRAM_HELP[HISTOGRAM_NUM];
+
+    std::mutex mtx_;                    // 只在注册分片/指标与抓取时加锁
+    std::vector<Shard*> shards_;        // 分片在进程生命周期内不释放
+    std::vector<Gauge> gauges_;
+};
+
+#endif //METRICS_H
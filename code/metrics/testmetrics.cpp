@@ -0,0 +1,68 @@
+#include "metrics.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <cassert>
+
+using namespace std;
+
+// 测试直方图分桶与分位数估算
+void TestHistogram() {
+    cout << "=== 测试直方图 ===" << endl;
+    for(uint64_t v = 0; v < 100000; v += 7) {
+        int idx = Histogram::BucketIndex(v);
+        assert(v < Histogram::BucketUpper(idx));
+        assert(idx == 0 || v >= Histogram::BucketUpper(idx - 1));
+    }
+
+    vector<uint64_t> counts(Histogram::BUCKET_NUM, 0);
+    for(uint64_t v = 1; v <= 1000; v++) {
+        counts[Histogram::BucketIndex(v)]++;
+    }
+    uint64_t p50 = Histogram::Percentile(counts, 0.5);
+    uint64_t p99 = Histogram::Percentile(counts, 0.99);
+    cout << "p50: " << p50 << "us, p99: " << p99 << "us" << endl;
+    assert(p50 >= 500 && p50 <= 500 * 9 / 8 + 1);
+    assert(p99 >= 990 && p99 <= 990 * 9 / 8 + 1);
+}
+
+// 测试多线程分片计数与聚合
+void TestShardedCounters() {
+    cout << "=== 测试分片计数 ===" << endl;
+    Metrics* metrics = Metrics::Instance();
+    vector<thread> threads;
+    for(int t = 0; t < 4; t++) {
+        threads.emplace_back([metrics]() {
+            for(int i = 0; i < 10000; i++) {
+                metrics->Add(Metrics::BYTES_IN, 2);
+                metrics->CountStatus(200);
+                metrics->Observe(Metrics::REQUEST_LATENCY, i % 1000);
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+    assert(metrics->GetCounter(Metrics::BYTES_IN) == 80000);
+
+    vector<uint64_t> counts;
+    uint64_t sum = 0;
+    metrics->GetHistogram(Metrics::REQUEST_LATENCY, counts, sum);
+    uint64_t total = 0;
+    for(auto c : counts) { total += c; }
+    assert(total == 40000);
+
+    metrics->RegisterGauge("webserver_test_gauge", "Test gauge.", []() { return 42.0; });
+    string text = metrics->Scrape();
+    assert(text.find("webserver_http_requests_total{code=\"200\"} 40000") != string::npos);
+    assert(text.find("webserver_test_gauge 42") != string::npos);
+    assert(text.find("webserver_http_request_duration_seconds_count 40000") != string::npos);
+    cout << text.substr(0, 400) << "..." << endl;
+}
+
+int main() {
+    TestHistogram();
+    TestShardedCounters();
+    cout << "所有指标测试通过" << endl;
+    return 0;
+}
@@ -1,9 +1,29 @@
 #include "sqlconnpool.h"
+#include <string.h>
+#include <mysql/errmsg.h>
+#include "../metrics/metrics.h"
 using namespace std;
 
+const int SqlConnPool::CHECK_INTERVAL_MS;
+const int SqlConnPool::IDLE_TIMEOUT_MS;
+const int SqlConnPool::CONNECT_TIMEOUT_S;
+const int SqlConnPool::WARMUP_CONCURRENCY;
+const int SqlConnPool::BACKOFF_MIN_MS;
+const int SqlConnPool::BACKOFF_MAX_MS;
+
 SqlConnPool::SqlConnPool() {
+    port_ = 0;
+    MAX_CONN_ = 0;
+    minConn_ = 0;
+    acquireTimeoutMs_ = 0;
     useCount_ = 0;
-    freeCount_ = 0;
+    totalCount_ = 0;
+    isClosed_ = true;
+    acquireTimeouts_ = 0;
+    backoffMs_ = 0;
+    warmNext_ = 0;
+    warmDone_ = 0;
+    warmReady_ = 0;
 }
 
 SqlConnPool* SqlConnPool::Instance() {
@@ -13,57 +33,306 @@ SqlConnPool* SqlConnPool::Instance() {
 
 void SqlConnPool::Init(const char* host, int port,
             const char* user,const char* pwd, const char* dbName,
-            int connSize = 10) {
+            int connSize, int minConn, int acquireTimeoutMs, int readyConn) {
     assert(connSize > 0);
-    for (int i = 0; i < connSize; i++) {
-        MYSQL *sql = nullptr;
-        sql = mysql_init(sql);
-        if (!sql) {
-            LOG_ERROR("MySql init error!");
-            assert(sql);
-        }
-        sql = mysql_real_connect(sql, host,
-                                 user, pwd,
-                                 dbName, port, nullptr, 0);
+    host_ = host;
+    port_ = port;
+    user_ = user;
+    pwd_ = pwd;
+    dbName_ = dbName;
+    MAX_CONN_ = connSize;
+    minConn_ = (minConn < 0 || minConn > connSize) ? connSize : minConn;
+    acquireTimeoutMs_ = acquireTimeoutMs;
+    isClosed_ = false;
+    int ready = (readyConn < 0 || readyConn > minConn_) ? minConn_ : readyConn;
+
+    /* 建立连接主要是等待数据库往返，多个线程并行建立；预热中的连接先计入totalCount_，
+       GetConn不会越过上限另建，而是等它们就绪 */
+    Clock::time_point start = Clock::now();
+    unique_lock<mutex> locker(mtx_);
+    totalCount_ = minConn_;
+    warmNext_ = warmDone_ = warmReady_ = 0;
+    int warmers = min(minConn_, static_cast<int>(WARMUP_CONCURRENCY));
+    for (int i = 0; i < warmers; i++) {
+        warmers_.emplace_back(&SqlConnPool::Warmup_, this);
+    }
+    warmCond_.wait(locker, [this, ready]() {
+        return warmReady_ >= ready || warmDone_ >= minConn_;
+    });
+    LOG_INFO("SqlConnPool warm-up: %d/%d ready in %lldms", warmReady_, minConn_,
+             static_cast<long long>(chrono::duration_cast<chrono::milliseconds>(Clock::now() - start).count()));
+    locker.unlock();
+    maintainer_ = std::thread(&SqlConnPool::Maintain_, this);
+}
+
+void SqlConnPool::Warmup_() {
+    unique_lock<mutex> locker(mtx_);
+    while(!isClosed_ && warmNext_ < minConn_) {
+        warmNext_++;
+        locker.unlock();
+        MYSQL *sql = Connect_();
+        locker.lock();
+        ConnectResult_(sql != nullptr);
         if (!sql) {
+            /* 连不上的不放入队列，由后台线程稍后补足 */
             LOG_ERROR("MySql Connect error!");
+            totalCount_--;
+        } else if (isClosed_) {
+            totalCount_--;
+            mysql_close(sql);
+        } else {
+            connQue_.push_back({ sql, Clock::now() });
+            warmReady_++;
+            cond_.notify_one();
         }
-        connQue_.push(sql);
+        warmDone_++;
+        warmCond_.notify_all();
     }
-    MAX_CONN_ = connSize;
-    sem_init(&semId_, 0, MAX_CONN_);
 }
 
-MYSQL* SqlConnPool::GetConn() {
-    MYSQL *sql = nullptr;
-    if(connQue_.empty()){
-        LOG_WARN("SqlConnPool busy!");
+MYSQL* SqlConnPool::Connect_(int timeoutS) {
+    MYSQL *sql = mysql_init(nullptr);
+    if (!sql) {
+        LOG_ERROR("MySql init error!");
         return nullptr;
     }
-    sem_wait(&semId_);
+    unsigned int timeout = timeoutS;
+    mysql_options(sql, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+    if (!mysql_real_connect(sql, host_.c_str(), user_.c_str(), pwd_.c_str(),
+                            dbName_.c_str(), port_, nullptr, 0)) {
+        LOG_WARN("MySql connect error: %s", mysql_error(sql));
+        mysql_close(sql);
+        return nullptr;
+    }
+    return sql;
+}
+
+void SqlConnPool::ConnectResult_(bool ok) {
+    if(ok) {
+        backoffMs_ = 0;
+        return;
+    }
+    backoffMs_ = backoffMs_ ? min(backoffMs_ * 2, static_cast<int>(BACKOFF_MAX_MS)) : static_cast<int>(BACKOFF_MIN_MS);
+    retryAt_ = Clock::now() + chrono::milliseconds(backoffMs_);
+}
+
+void SqlConnPool::Close_(MYSQL* sql) {
+    ResetStmts(sql);
     {
         lock_guard<mutex> locker(mtx_);
-        sql = connQue_.front();
-        connQue_.pop();
+        stmts_.erase(sql);
+    }
+    mysql_close(sql);
+}
+
+MYSQL* SqlConnPool::GetConn() {
+    return GetConn(acquireTimeoutMs_);
+}
+
+MYSQL* SqlConnPool::GetConn(int timeoutMs) {
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + chrono::milliseconds(timeoutMs);
+    MYSQL *sql = nullptr;
+    unique_lock<mutex> locker(mtx_);
+    while(!isClosed_) {
+        if(!connQue_.empty()) {
+            sql = connQue_.back().sql;
+            connQue_.pop_back();
+            break;
+        }
+        Clock::time_point now = Clock::now();
+        bool backoff = backoffMs_ > 0 && now < retryAt_;
+        if(totalCount_ < MAX_CONN_ && !backoff) {
+            /* 先占住名额再在锁外建立连接；连接超时以秒为单位，按剩余等待时间向上取整，不超过CONNECT_TIMEOUT_S */
+            long long leftMs = chrono::duration_cast<chrono::milliseconds>(deadline - now).count();
+            if(leftMs <= 0) { break; }
+            int timeoutS = min(static_cast<int>((leftMs + 999) / 1000), static_cast<int>(CONNECT_TIMEOUT_S));
+            totalCount_++;
+            locker.unlock();
+            sql = Connect_(timeoutS);
+            locker.lock();
+            ConnectResult_(sql != nullptr);
+            if(!sql) {
+                /* 数据库不可达时直接失败，不在这里等到超时；之后的请求在退避期内不再尝试新建 */
+                totalCount_--;
+                cond_.notify_one();
+            }
+            break;
+        }
+        if(backoff && totalCount_ == 0) {
+            /* 退避期内没有可等待归还的连接，直接失败，重连交给后台线程 */
+            break;
+        }
+        /* 退避期间也等待归还的连接，退避结束后可再尝试新建 */
+        Clock::time_point until = (backoff && retryAt_ < deadline) ? retryAt_ : deadline;
+        cond_.wait_until(locker, until);
+        if(connQue_.empty() && Clock::now() >= deadline) {
+            LOG_WARN("SqlConnPool busy!");
+            acquireTimeouts_.fetch_add(1, memory_order_relaxed);
+            break;
+        }
     }
+    if(sql) { useCount_++; }
+    locker.unlock();
+    Metrics::Instance()->Observe(Metrics::SQL_ACQUIRE,
+        chrono::duration_cast<chrono::microseconds>(Clock::now() - start).count());
     return sql;
 }
 
 void SqlConnPool::FreeConn(MYSQL* sql) {
     assert(sql);
+    unsigned int err = mysql_errno(sql);
+    if(err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST) {
+        /* 连接已断开，关闭后让出名额，需要时再新建 */
+        LOG_WARN("MySql connection lost: %s", mysql_error(sql));
+        Close_(sql);
+        lock_guard<mutex> locker(mtx_);
+        useCount_--;
+        totalCount_--;
+        cond_.notify_one();
+        return;
+    }
     lock_guard<mutex> locker(mtx_);
-    connQue_.push(sql);
-    sem_post(&semId_);
+    useCount_--;
+    connQue_.push_back({ sql, Clock::now() });
+    cond_.notify_one();
+}
+
+void SqlConnPool::Maintain_() {
+    unique_lock<mutex> locker(mtx_);
+    while(!isClosed_) {
+        maintainCond_.wait_for(locker, chrono::milliseconds(CHECK_INTERVAL_MS));
+        if(isClosed_) { break; }
+        Clock::time_point now = Clock::now();
+
+        /* 多余的连接：从空闲最久的开始关闭 */
+        vector<MYSQL*> expired;
+        while(!connQue_.empty() && totalCount_ > minConn_ &&
+              now - connQue_.front().since > chrono::milliseconds(IDLE_TIMEOUT_MS)) {
+            expired.push_back(connQue_.front().sql);
+            connQue_.pop_front();
+            totalCount_--;
+        }
+        /* 空闲较久的连接取出来ping，期间仍计入totalCount_ */
+        vector<MYSQL*> idle;
+        for(auto it = connQue_.begin(); it != connQue_.end(); ) {
+            if(now - it->since > chrono::milliseconds(CHECK_INTERVAL_MS)) {
+                idle.push_back(it->sql);
+                it = connQue_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        int lack = max(minConn_ - totalCount_, 0);
+        totalCount_ += lack;
+        locker.unlock();
+
+        for(MYSQL* sql : expired) {
+            Close_(sql);
+        }
+        vector<MYSQL*> alive;
+        for(MYSQL* sql : idle) {
+            if(mysql_ping(sql) == 0) {
+                alive.push_back(sql);
+                continue;
+            }
+            LOG_WARN("MySql ping error: %s, reconnecting", mysql_error(sql));
+            Close_(sql);
+            if((sql = Connect_())) { alive.push_back(sql); }
+        }
+        for(int i = 0; i < lack; i++) {
+            MYSQL* sql = Connect_();
+            if(sql) { alive.push_back(sql); }
+        }
+
+        locker.lock();
+        if(static_cast<int>(idle.size()) + lack > 0) {
+            /* 后台重连成功即结束退避，GetConn可立即新建连接 */
+            ConnectResult_(alive.size() > 0);
+        }
+        totalCount_ -= static_cast<int>(idle.size()) + lack - static_cast<int>(alive.size());
+        if(isClosed_) {
+            /* 检查期间连接池已关闭，不再放回 */
+            locker.unlock();
+            for(MYSQL* sql : alive) { Close_(sql); }
+            return;
+        }
+        now = Clock::now();
+        for(MYSQL* sql : alive) {
+            /* 放到队首：刚检查过的连接与其他空闲连接一样，优先取用最近归还的 */
+            connQue_.push_front({ sql, now });
+            cond_.notify_one();
+        }
+    }
+}
+
+MYSQL_STMT* SqlConnPool::GetStmt(MYSQL* sql, const char* query) {
+    assert(sql && query);
+    StmtCache* cache = nullptr;
+    {
+        /* 只有外层表需要加锁；内层表只被持有连接的线程访问，且unordered_map的元素地址不随插入改变 */
+        lock_guard<mutex> locker(mtx_);
+        cache = &stmts_[sql];
+    }
+    auto it = cache->find(query);
+    if(it != cache->end()) {
+        return it->second;
+    }
+    MYSQL_STMT* stmt = mysql_stmt_init(sql);
+    if(!stmt) {
+        LOG_ERROR("MySql stmt init error!");
+        return nullptr;
+    }
+    if(mysql_stmt_prepare(stmt, query, strlen(query))) {
+        LOG_ERROR("MySql prepare error: %s", mysql_stmt_error(stmt));
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    (*cache)[query] = stmt;
+    return stmt;
+}
+
+void SqlConnPool::ResetStmts(MYSQL* sql) {
+    StmtCache cache;
+    {
+        lock_guard<mutex> locker(mtx_);
+        auto it = stmts_.find(sql);
+        if(it == stmts_.end()) { return; }
+        cache.swap(it->second);
+    }
+    for(auto& item : cache) {
+        mysql_stmt_close(item.second);
+    }
 }
 
 void SqlConnPool::ClosePool() {
+    {
+        lock_guard<mutex> locker(mtx_);
+        isClosed_ = true;
+    }
+    maintainCond_.notify_all();
+    cond_.notify_all();
+    if(maintainer_.joinable() && maintainer_.get_id() != this_thread::get_id()) {
+        maintainer_.join();
+    }
+    for(auto& warmer : warmers_) {
+        if(warmer.joinable()) { warmer.join(); }
+    }
+    warmers_.clear();
     lock_guard<mutex> locker(mtx_);
+    /* 语句依附于连接，先于连接关闭 */
+    for(auto& conn : stmts_) {
+        for(auto& item : conn.second) {
+            mysql_stmt_close(item.second);
+        }
+    }
+    stmts_.clear();
     while(!connQue_.empty()) {
-        auto item = connQue_.front();
-        connQue_.pop();
-        mysql_close(item);
+        mysql_close(connQue_.front().sql);
+        connQue_.pop_front();
+        totalCount_--;
     }
-    mysql_library_end();        
+    mysql_library_end();
 }
 
 int SqlConnPool::GetFreeConnCount() {
@@ -71,6 +340,11 @@ int SqlConnPool::GetFreeConnCount() {
     return connQue_.size();
 }
 
+int SqlConnPool::GetConnCount() {
+    lock_guard<mutex> locker(mtx_);
+    return totalCount_;
+}
+
 SqlConnPool::~SqlConnPool() {
     ClosePool();
 }
@@ -3,37 +3,97 @@
 
 #include <mysql/mysql.h>
 #include <string>
-#include <queue>
+#include <deque>
+#include <vector>
+#include <unordered_map>
 #include <mutex>
-#include <semaphore.h>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
 #include <thread>
 #include "../log/log.h"
 
+/*
+ * 连接数在 [minConn, maxConn] 之间伸缩：空闲连接不够时按需新建，直到maxConn；
+ * 后台线程定期ping空闲连接并重连断开的连接、关闭空闲过久的多余连接、连接数低于minConn时补足，
+ * 数据库重启后连接池能自行恢复
+ */
 class SqlConnPool {
 public:
     static SqlConnPool *Instance();     //单例模式核心，返回连接池唯一实例（确保全局只有一个连接池）
 
-    MYSQL *GetConn();                   //从连接池获取一个数据库连接
-    void FreeConn(MYSQL * conn);        //将用完的连接归还给连接池（而非关闭）
+    MYSQL *GetConn();                   //从连接池获取一个数据库连接，最多等待acquireTimeoutMs，超时或无法连接时返回nullptr
+    MYSQL *GetConn(int timeoutMs);      //同上，指定等待时间（毫秒）
+    void FreeConn(MYSQL * conn);        //将用完的连接归还给连接池（而非关闭），已断开的连接直接关闭
     int GetFreeConnCount();             //获取当前空闲连接的数量
+    int GetConnCount();                 //获取当前打开的连接数（含使用中的）
+    uint64_t GetAcquireTimeouts() const { return acquireTimeouts_.load(std::memory_order_relaxed); }  //等待连接超时的次数
+
+    /* 预处理语句按连接缓存：同一条SQL在每个连接上只prepare一次，之后以二进制参数执行
+       只能由当前持有该连接的线程调用，返回的语句随连接一起由连接池管理，调用方不要关闭 */
+    MYSQL_STMT *GetStmt(MYSQL *conn, const char *query);    //取连接上已预处理的语句，首次使用时prepare，失败返回nullptr
+    void ResetStmts(MYSQL *conn);       //执行出错后关闭该连接上缓存的全部语句，下次使用时重新prepare
 
     void Init(const char* host, int port,
-              const char* user,const char* pwd, 
-              const char* dbName, int connSize);    //初始化连接池：指定数据库地址、端口、账号等信息，并创建初始连接
+              const char* user,const char* pwd,
+              const char* dbName, int connSize,
+              int minConn = -1, int acquireTimeoutMs = 1000,
+              int readyConn = -1);  //初始化连接池：connSize为连接数上限，并行建立minConn个连接（-1表示与上限相同），
+                                    //其中readyConn个就绪（-1表示全部）即返回，其余在后台继续建立
      void ClosePool();                   //关闭连接池：释放所有连接资源，销毁队列
 
 private:
     SqlConnPool();
     ~SqlConnPool();
 
+    typedef std::chrono::steady_clock Clock;
+
+    /* 空闲连接及其归还时间 */
+    struct IdleConn {
+        MYSQL *sql;
+        Clock::time_point since;
+    };
+
+    static const int CHECK_INTERVAL_MS = 5000;  // 后台检查周期，空闲超过该时间的连接在检查时ping
+    static const int IDLE_TIMEOUT_MS = 60000;   // 连接数超过minConn时，空闲超过该时间的连接被关闭
+    static const int CONNECT_TIMEOUT_S = 3;     // 建立连接的超时，避免数据库不可达时长时间阻塞
+    static const int WARMUP_CONCURRENCY = 8;    // 启动时同时建立连接的线程数上限
+    static const int BACKOFF_MIN_MS = 200;      // 建立连接失败后，GetConn暂停新建连接的初始时长
+    static const int BACKOFF_MAX_MS = 5000;     // 连续失败时退避时长加倍，最多到该值
+
+    MYSQL *Connect_(int timeoutS = CONNECT_TIMEOUT_S);  // 新建一个连接，失败返回nullptr
+    void ConnectResult_(bool ok);       // 记录建立连接的结果，失败时推迟GetConn下一次新建连接，须持有mtx_
+    void Close_(MYSQL *sql);            // 关闭连接及其预处理语句
+    void Maintain_();                   // 后台线程：健康检查、重连、收缩与补足
+    void Warmup_();                     // 预热线程：领取并建立启动时的连接，直到minConn个都尝试过
+
+    std::string host_, user_, pwd_, dbName_;
+    int port_;
+
     int MAX_CONN_;       // 最大连接数（连接池容量上限）
+    int minConn_;        // 最少保持的连接数
+    int acquireTimeoutMs_;  // 获取连接的默认等待时间
     int useCount_;       // 当前正在使用的连接数
-    int freeCount_;      // 当前空闲的连接数
+    int totalCount_;     // 已打开及正在建立的连接数（含使用中、空闲和后台检查中的）
+    bool isClosed_;      // 连接池是否已关闭
+    std::atomic<uint64_t> acquireTimeouts_;  // 等待连接超时的次数
+    int backoffMs_;               // 当前退避时长，建立连接成功后清零
+    Clock::time_point retryAt_;   // 退避结束时间，此前GetConn不新建连接，只等待归还的连接
 
-    std::queue<MYSQL *> connQue_;  // 存储数据库连接的队列（核心容器）
+    std::deque<IdleConn> connQue_; // 空闲连接，从队尾取用/归还（后进先出），队首是空闲最久的
     std::mutex mtx_;               // 互斥锁：保证对队列的操作（获取/归还连接）线程安全
-    sem_t semId_;                  // 信号量：用于控制空闲连接的数量（获取连接前检查是否有空闲）
+    std::condition_variable cond_; // 有连接归还或可以新建连接时唤醒等待者
+    std::condition_variable maintainCond_;  // 唤醒后台线程（关闭时）
+    std::thread maintainer_;       // 后台检查线程
+    std::vector<std::thread> warmers_;  // 预热线程
+    int warmNext_;                 // 下一个待建立的预热连接序号
+    int warmDone_;                 // 已尝试完的预热连接数（成功或失败）
+    int warmReady_;                // 预热成功的连接数
+    std::condition_variable warmCond_;  // 预热进展时唤醒Init
+
+    typedef std::unordered_map<std::string, MYSQL_STMT *> StmtCache;
+    std::unordered_map<MYSQL *, StmtCache> stmts_;  // 每个连接的预处理语句（SQL文本 -> 语句），外层表的增删在mtx_下进行
 };
 
 
-#endif // SQLCONNPOOL_H
\ No newline at end of file
+#endif // SQLCONNPOOL_H
@@ -0,0 +1,57 @@
+#ifndef SQLEXECUTOR_H
+#define SQLEXECUTOR_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "threadpool.h"
+
+/*
+ * 专门执行阻塞式数据库操作的小线程池
+ * 工作线程把查询交给它后立即返回处理其他连接，查询在这里的线程上阻塞执行，完成后通过回调恢复请求，
+ * 慢查询只占用SQL线程，不会拖住线程池中排在后面的连接
+ * 线程数不宜超过数据库连接池大小，多出的线程只会阻塞在取连接上
+ * 口令哈希这类耗CPU的操作也用一个单独的实例执行，以线程数限制并发、以maxPending限制排队
+ */
+class SqlExecutor {
+public:
+    typedef std::function<bool()> Query;          // 阻塞执行的数据库操作，返回操作结果
+    typedef std::function<void(bool)> Callback;   // 查询完成后在SQL线程上调用，参数为Query的结果
+
+    SqlExecutor(size_t threadCount, size_t maxPending)
+        : pool_(threadCount), maxPending_(maxPending),
+          pending_(std::make_shared<std::atomic<size_t>>(0)) {
+        assert(maxPending > 0);
+    }
+
+    SqlExecutor(const SqlExecutor&) = delete;
+    SqlExecutor& operator=(const SqlExecutor&) = delete;
+
+    // 提交查询，排队和执行中的查询数已达上限时返回false，由调用方按失败处理
+    bool Submit(Query query, Callback done) {
+        if(pending_->fetch_add(1) >= maxPending_) {
+            pending_->fetch_sub(1);
+            return false;
+        }
+        //按值捕获计数器，任务晚于SqlExecutor析构执行时也不会访问悬空的this
+        auto pending = pending_;
+        pool_.AddTask([query, done, pending]() {
+            bool result = query();
+            pending->fetch_sub(1);
+            done(result);
+        });
+        return true;
+    }
+
+    //排队和执行中的查询数
+    size_t Pending() const {
+        return pending_->load();
+    }
+
+private:
+    ThreadPool pool_;
+    size_t maxPending_;
+    std::shared_ptr<std::atomic<size_t>> pending_;
+};
+
+#endif //SQLEXECUTOR_H
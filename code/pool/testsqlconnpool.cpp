@@ -4,6 +4,7 @@
 #include <vector>
 #include <atomic>
 #include <cassert>
+#include <chrono>
 
 // 测试单个连接的基本操作
 void testSingleConnection() {
@@ -33,6 +34,80 @@ void testSingleConnection() {
     std::cout << "单连接测试完成" << std::endl;
 }
 
+// 测试预处理语句缓存：同一连接上同一SQL只prepare一次
+void testStmtCache() {
+    std::cout << "\n=== 测试预处理语句缓存 ===" << std::endl;
+    auto pool = SqlConnPool::Instance();
+    MYSQL* conn = pool->GetConn();
+    if (!conn) {
+        std::cerr << "获取连接失败!" << std::endl;
+        return;
+    }
+    const char* query = "SELECT password FROM user WHERE username=? LIMIT 1";
+    MYSQL_STMT* first = pool->GetStmt(conn, query);
+    MYSQL_STMT* second = pool->GetStmt(conn, query);
+    assert(first != nullptr);
+    assert(first == second);
+    MYSQL_STMT* other = pool->GetStmt(conn, "INSERT INTO user(username, password) VALUES(?,?)");
+    assert(other != nullptr && other != first);
+
+    /* 出错重置后重新prepare */
+    pool->ResetStmts(conn);
+    MYSQL_STMT* again = pool->GetStmt(conn, query);
+    assert(again != nullptr);
+    assert(pool->GetStmt(conn, query) == again);
+
+    pool->FreeConn(conn);
+    std::cout << "预处理语句缓存测试完成" << std::endl;
+}
+
+// 测试限时获取：连接用尽后等待，超时返回nullptr，有连接归还时立即返回
+void testTimedAcquire() {
+    std::cout << "\n=== 测试限时获取连接 ===" << std::endl;
+    auto pool = SqlConnPool::Instance();
+    std::vector<MYSQL*> held;
+    while (true) {
+        MYSQL* conn = pool->GetConn(0);
+        if (!conn) { break; }
+        held.push_back(conn);
+    }
+    std::cout << "连接上限内全部取出: " << held.size() << "，当前连接数: " << pool->GetConnCount() << std::endl;
+    if (held.empty()) {
+        std::cerr << "获取连接失败!" << std::endl;
+        return;
+    }
+    assert(pool->GetFreeConnCount() == 0);
+
+    auto start = std::chrono::steady_clock::now();
+    MYSQL* conn = pool->GetConn(100);
+    auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    assert(conn == nullptr);
+    assert(waited >= 100);
+    std::cout << "连接用尽时等待 " << waited << "ms 后超时" << std::endl;
+
+    /* 另一个线程50ms后归还一个连接，等待者被唤醒 */
+    MYSQL* back = held.back();
+    held.pop_back();
+    std::thread releaser([pool, back]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        pool->FreeConn(back);
+    });
+    start = std::chrono::steady_clock::now();
+    conn = pool->GetConn(1000);
+    waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    releaser.join();
+    assert(conn == back);
+    assert(waited < 1000);
+    std::cout << "等待 " << waited << "ms 后取得归还的连接" << std::endl;
+    held.push_back(conn);
+
+    for (MYSQL* c : held) { pool->FreeConn(c); }
+    assert(pool->GetFreeConnCount() == pool->GetConnCount());
+    std::cout << "限时获取测试完成" << std::endl;
+}
+
 // 线程函数：模拟并发操作
 std::atomic_int successCount(0);
 std::atomic_int failCount(0);
@@ -104,6 +179,12 @@ int main() {
     // 测试单连接
     testSingleConnection();
 
+    // 测试预处理语句缓存
+    testStmtCache();
+
+    // 测试限时获取
+    testTimedAcquire();
+
     // 测试多线程并发
     testMultiThread(10, 20);
 
@@ -0,0 +1,134 @@
+#include "sqlexecutor.h"
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cassert>
+
+using namespace std;
+using namespace chrono;
+
+/* 模拟的用户库：行为与UserVerify一致，每次查询固定延迟，代替MySQL */
+class MockUserDb {
+public:
+    explicit MockUserDb(int latencyMs) : latencyMs_(latencyMs), queries_(0) {}
+
+    bool Verify(const string& name, const string& pwd, bool isLogin) {
+        this_thread::sleep_for(milliseconds(latencyMs_));
+        queries_++;
+        lock_guard<mutex> locker(mtx_);
+        auto it = users_.find(name);
+        if(isLogin) {
+            return it != users_.end() && it->second == pwd;
+        }
+        if(it != users_.end()) { return false; }
+        users_[name] = pwd;
+        return true;
+    }
+
+    int Queries() const { return queries_; }
+
+private:
+    int latencyMs_;
+    atomic<int> queries_;
+    mutex mtx_;
+    unordered_map<string, string> users_;
+};
+
+// 等待条件成立，超时返回false
+template<class Pred>
+static bool WaitFor(Pred pred, int timeoutMs) {
+    auto deadline = steady_clock::now() + milliseconds(timeoutMs);
+    while(!pred()) {
+        if(steady_clock::now() > deadline) { return false; }
+        this_thread::sleep_for(milliseconds(1));
+    }
+    return true;
+}
+
+// 慢查询在SQL线程上执行，工作线程提交后立即返回，后续任务不被阻塞
+void testWorkerNotBlocked() {
+    cout << "=== 测试慢查询不阻塞工作线程 ===" << endl;
+    MockUserDb db(100);
+    SqlExecutor executor(4, 64);
+    ThreadPool workers(1);
+    atomic<int> done(0);
+    atomic<bool> quickDone(false);
+
+    auto start = steady_clock::now();
+    for(int i = 0; i < 4; i++) {
+        workers.AddTask([&db, &executor, &done, i]() {
+            string name = "user" + to_string(i);
+            bool ok = executor.Submit([&db, name]() { return db.Verify(name, "pwd", false); },
+                                      [&done](bool result) { assert(result); done++; });
+            assert(ok);
+        });
+    }
+    /* 只有一个工作线程：若查询在工作线程上同步执行，这个任务要等400ms */
+    workers.AddTask([&quickDone]() { quickDone = true; });
+    assert(WaitFor([&quickDone]() { return quickDone.load(); }, 50));
+    long quickMs = duration_cast<milliseconds>(steady_clock::now() - start).count();
+
+    assert(WaitFor([&done]() { return done.load() == 4; }, 1000));
+    long totalMs = duration_cast<milliseconds>(steady_clock::now() - start).count();
+    cout << "排在查询后的任务完成: " << quickMs << "ms，4个100ms查询全部完成: " << totalMs << "ms" << endl;
+    assert(totalMs < 300);
+    assert(executor.Pending() == 0);
+}
+
+// 登录/注册结果按模拟库的状态回调
+void testResults() {
+    cout << "\n=== 测试查询结果 ===" << endl;
+    MockUserDb db(1);
+    SqlExecutor executor(2, 64);
+    atomic<int> results[4];
+    for(auto& r : results) { r = -1; }
+
+    auto submit = [&db, &executor](const string& name, const string& pwd, bool isLogin, atomic<int>& out) {
+        executor.Submit([&db, name, pwd, isLogin]() { return db.Verify(name, pwd, isLogin); },
+                        [&out](bool result) { out = result ? 1 : 0; });
+    };
+    submit("alice", "1", false, results[0]);   /* 注册 */
+    assert(WaitFor([&results]() { return results[0] != -1; }, 1000));
+    submit("alice", "2", false, results[1]);   /* 重复注册 */
+    submit("alice", "1", true, results[2]);    /* 正确密码登录 */
+    submit("alice", "x", true, results[3]);    /* 错误密码登录 */
+    assert(WaitFor([&results]() {
+        return results[1] != -1 && results[2] != -1 && results[3] != -1;
+    }, 1000));
+    assert(results[0] == 1 && results[1] == 0 && results[2] == 1 && results[3] == 0);
+    cout << "注册/重复注册/登录/错误密码: " << results[0] << results[1] << results[2] << results[3] << endl;
+}
+
+// 排队和执行中的查询达到上限后拒绝提交
+void testMaxPending() {
+    cout << "\n=== 测试排队上限 ===" << endl;
+    MockUserDb db(50);
+    SqlExecutor executor(1, 3);
+    atomic<int> done(0);
+    int accepted = 0;
+    for(int i = 0; i < 5; i++) {
+        string name = "u" + to_string(i);
+        if(executor.Submit([&db, name]() { return db.Verify(name, "p", false); },
+                           [&done](bool) { done++; })) {
+            accepted++;
+        }
+    }
+    assert(accepted == 3);
+    assert(executor.Pending() == 3);
+    assert(WaitFor([&done]() { return done.load() == 3; }, 1000));
+    assert(executor.Pending() == 0);
+    assert(db.Queries() == 3);
+    cout << "提交5个，接受: " << accepted << endl;
+}
+
+int main() {
+    testWorkerNotBlocked();
+    testResults();
+    testMaxPending();
+    cout << "\n所有测试通过" << endl;
+    return 0;
+}
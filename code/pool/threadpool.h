@@ -13,8 +13,9 @@ public:
     ThreadPool(size_t threadCount = 8): pool_(std::make_shared<Pool>()) {
             assert(threadCount > 0);
             for(size_t i = 0; i < threadCount; i++) {
-                std::thread([this] {
-                    auto pool = this->pool_;
+                //按值捕获pool_，线程晚于ThreadPool析构才启动时也不会访问悬空的this
+                auto pool = pool_;
+                std::thread([pool] {
                     std::unique_lock<std::mutex> locker(pool->mtx);
                     while(true) {
                         if(!pool->tasks.empty()) {
@@ -54,6 +55,12 @@ public:
         pool_->cond.notify_one();
     }
 
+    //返回排队等待执行的任务数
+    size_t QueueSize() {
+        std::lock_guard<std::mutex> locker(pool_->mtx);
+        return pool_->tasks.size();
+    }
+
 private:
     //存储线程池核心资源：互斥锁、条件变量、任务队列、关闭标志
     struct Pool {
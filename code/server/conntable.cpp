@@ -0,0 +1,89 @@
+#include "conntable.h"
+#include <stdlib.h>
+#include <new>
+
+const int ConnTable::BLOCK_SIZE;
+const int ConnTable::GENERATION_SHIFT;
+const uint64_t ConnTable::POINTER_MASK;
+
+ConnTable::ConnTable(int maxFd) : maxFd_(maxFd),
+    blocks_((maxFd + BLOCK_SIZE - 1) / BLOCK_SIZE, nullptr) {
+    assert(maxFd > 0);
+}
+
+ConnTable::~ConnTable() {
+    for(HttpConn* block : blocks_) {
+        if(block) { FreeBlock_(block); }
+    }
+}
+
+HttpConn* ConnTable::AllocBlock_() {
+    /* C++11 的 new 不保证超过16字节的对齐，按 HttpConn 的对齐要求手动分配后原地构造 */
+    void* mem = nullptr;
+    if(posix_memalign(&mem, alignof(HttpConn), sizeof(HttpConn) * BLOCK_SIZE) != 0) {
+        throw std::bad_alloc();
+    }
+    HttpConn* block = static_cast<HttpConn*>(mem);
+    for(int i = 0; i < BLOCK_SIZE; i++) {
+        new (block + i) HttpConn();
+    }
+    return block;
+}
+
+void ConnTable::FreeBlock_(HttpConn* block) {
+    for(int i = 0; i < BLOCK_SIZE; i++) {
+        block[i].~HttpConn();
+    }
+    free(block);
+}
+
+HttpConn* ConnTable::Get(int fd) {
+    assert(fd >= 0 && fd < maxFd_);
+    HttpConn*& block = blocks_[fd / BLOCK_SIZE];
+    if(!block) {
+        block = AllocBlock_();
+    }
+    return block + fd % BLOCK_SIZE;
+}
+
+HttpConn* ConnTable::Find(int fd) const {
+    if(fd < 0 || fd >= maxFd_) { return nullptr; }
+    HttpConn* block = blocks_[fd / BLOCK_SIZE];
+    return block ? block + fd % BLOCK_SIZE : nullptr;
+}
+
+size_t ConnTable::BlockCount() const {
+    size_t n = 0;
+    for(HttpConn* block : blocks_) {
+        if(block) { n++; }
+    }
+    return n;
+}
+
+int ConnTable::Reserve(int fdCount) {
+    if(fdCount > maxFd_) { fdCount = maxFd_; }
+    int blocks = fdCount > 0 ? (fdCount + BLOCK_SIZE - 1) / BLOCK_SIZE : 0;
+    for(int i = 0; i < blocks; i++) {
+        if(!blocks_[i]) { blocks_[i] = AllocBlock_(); }
+    }
+    return blocks * BLOCK_SIZE < maxFd_ ? blocks * BLOCK_SIZE : maxFd_;
+}
+
+uint64_t ConnTable::Pack(const HttpConn* conn) {
+    uint64_t ptr = reinterpret_cast<uintptr_t>(conn);
+    assert((ptr & ~POINTER_MASK) == 0);
+    return ptr | (static_cast<uint64_t>(static_cast<uint16_t>(conn->Generation())) << GENERATION_SHIFT);
+}
+
+HttpConn* ConnTable::Unpack(uint64_t data, uint16_t* generation) {
+    if(generation) {
+        *generation = static_cast<uint16_t>(data >> GENERATION_SHIFT);
+    }
+    return reinterpret_cast<HttpConn*>(static_cast<uintptr_t>(data & POINTER_MASK));
+}
+
+bool ConnTable::IsStale(uint64_t data) {
+    uint16_t generation = 0;
+    HttpConn* conn = Unpack(data, &generation);
+    return static_cast<uint16_t>(conn->Generation()) != generation;
+}
@@ -0,0 +1,48 @@
+#ifndef CONN_TABLE_H
+#define CONN_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "../http/httpconn.h"
+
+/*
+ * 按fd下标索引的连接表，代替 unordered_map<int, HttpConn>
+ * 槽位按块（BLOCK_SIZE个连接）分配，块在其中的fd第一次出现时才分配，之后一直保留，
+ * 因此工作线程持有的 HttpConn* 在服务器运行期间始终有效；每个连接按缓存行对齐，相邻连接不共享缓存行
+ *
+ * 事件分发不查表：注册到epoll时把连接指针和代数打包进 epoll_event.data（Pack），
+ * 事件到达时直接解包（Unpack）。连接关闭时代数加一，fd被复用后仍在途的旧事件代数对不上，据此丢弃
+ */
+class ConnTable {
+public:
+    static const int BLOCK_SIZE = 256;
+
+    explicit ConnTable(int maxFd);
+    ~ConnTable();
+
+    ConnTable(const ConnTable&) = delete;
+    ConnTable& operator=(const ConnTable&) = delete;
+
+    HttpConn* Get(int fd);              // 取fd对应的连接，所在块尚未分配时先分配（只在主线程调用）
+    HttpConn* Find(int fd) const;       // 只查不分配，块未分配时返回nullptr
+    size_t BlockCount() const;          // 已分配的块数
+    int Reserve(int fdCount);           // 预先分配覆盖 [0, fdCount) 的块，避免连接洪峰时在accept路径上分配，返回实际覆盖的fd数
+
+    /* 指针的低48位是用户态地址，高16位存放代数 */
+    static uint64_t Pack(const HttpConn* conn);
+    static HttpConn* Unpack(uint64_t data, uint16_t* generation);
+    static bool IsStale(uint64_t data); // 事件携带的代数与连接当前代数不一致
+
+private:
+    static const int GENERATION_SHIFT = 48;
+    static const uint64_t POINTER_MASK = (1ULL << GENERATION_SHIFT) - 1;
+
+    HttpConn* AllocBlock_();
+    static void FreeBlock_(HttpConn* block);
+
+    int maxFd_;
+    std::vector<HttpConn*> blocks_;     // 下标为 fd / BLOCK_SIZE
+};
+
+#endif //CONN_TABLE_H
@@ -23,6 +23,10 @@ public:
     // 修改文件描述符的监听事件
     bool ModFd(int fd, uint32_t events);
 
+    // 同上，事件携带调用方提供的data（如连接指针），而不是fd
+    bool AddFd(int fd, uint32_t events, uint64_t data);
+    bool ModFd(int fd, uint32_t events, uint64_t data);
+
     // 从epoll监听列表中删除文件描述符
     bool DelFd(int fd);
 
@@ -32,6 +36,9 @@ public:
     // 获取第i个事件的文件描述符
     int GetEventFd(size_t i) const;
 
+    // 获取第i个事件携带的data（用带data的AddFd/ModFd注册时）
+    uint64_t GetEventData(size_t i) const;
+
     // 获取第i个事件的事件类型
     uint32_t GetEvents(size_t i) const;
         
@@ -0,0 +1,59 @@
+#include "conntable.h"
+#include <iostream>
+#include <cassert>
+#include <sys/socket.h>
+
+int main() {
+    ConnTable table(1024);
+    assert(table.BlockCount() == 0);
+    assert(table.Find(10) == nullptr);
+
+    // 测试按块分配，同一块内的fd共享一次分配
+    HttpConn* a = table.Get(10);
+    HttpConn* b = table.Get(11);
+    assert(table.BlockCount() == 1);
+    assert(b == a + 1);
+    assert(table.Find(10) == a);
+    assert(table.Find(ConnTable::BLOCK_SIZE) == nullptr);
+    table.Get(ConnTable::BLOCK_SIZE + 1);
+    assert(table.BlockCount() == 2);
+    assert(table.Get(10) == a);     // 指针在表的生命周期内保持不变
+
+    // 测试预分配：覆盖范围按块向上取整，已分配的块保持不变，不超过maxFd
+    assert(table.Reserve(ConnTable::BLOCK_SIZE * 2 + 1) == ConnTable::BLOCK_SIZE * 3);
+    assert(table.BlockCount() == 3);
+    assert(table.Find(ConnTable::BLOCK_SIZE * 2 + 5) != nullptr);
+    assert(table.Get(10) == a);
+    assert(table.Reserve(100000) == 1024);
+    assert(table.BlockCount() == 4);
+
+    // 测试缓存行对齐
+    assert(reinterpret_cast<uintptr_t>(a) % 64 == 0);
+    assert(reinterpret_cast<uintptr_t>(b) % 64 == 0);
+    std::cout << "sizeof(HttpConn): " << sizeof(HttpConn) << std::endl;
+
+    // 测试 Pack/Unpack 与过期事件识别
+    int fds[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    HttpConn* conn = table.Get(fds[0]);
+    sockaddr_in addr = { 0 };
+    conn->init(fds[0], addr);
+    uint64_t data = ConnTable::Pack(conn);
+    uint16_t generation = 0;
+    assert(ConnTable::Unpack(data, &generation) == conn);
+    assert(generation == conn->Generation());
+    assert(!ConnTable::IsStale(data));
+
+    conn->Close();      // 关闭后旧事件过期
+    close(fds[1]);
+    assert(ConnTable::IsStale(data));
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    conn->init(fds[0], addr);       // 连接槽复用：新注册的事件有效，旧事件仍然过期
+    assert(!ConnTable::IsStale(ConnTable::Pack(conn)));
+    assert(ConnTable::IsStale(data));
+    conn->Close();
+    close(fds[1]);
+
+    std::cout << "ConnTable tests passed" << std::endl;
+    return 0;
+}
@@ -6,40 +6,117 @@ WebServer::WebServer(
             int port, int trigMode, int timeoutMS, bool OptLinger,
             int sqlPort, const char* sqlUser, const  char* sqlPwd,
             const char* dbName, int connPoolNum, int threadNum,
-            bool openLog, int logLevel, int logQueSize):
+            bool openLog, int logLevel, int logQueSize,
+            int logOverflow, int logSampleRate,
+            int logMaxFileMB, bool logCompress,
+            const char* metricsPath, int metricsPort, int slowRequestMs,
+            int bufferMode, int idleBufferKB, int sqlThreadNum,
+            int sqlMinConn, int sqlAcquireTimeoutMs, int sqlReadyConn,
+            int userCacheTtlS, int hashThreadNum, int pwdHashIterations,
+            int registerBatchMs, int registerBatchRows,
+            const char* userStore, const char* userStorePath,
+            int inlineMaxKB, int preallocConns,
+            int deferAcceptS, int fastOpenQueue):
             port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS), isClose_(false),
-            timer_(new HeapTimer()), threadpool_(new ThreadPool(threadNum)), epoller_(new Epoller())
+            listenFd_(-1), metricsPath_(metricsPath ? metricsPath : ""), metricsPort_(metricsPort), adminListenFd_(-1), wakeFd_(-1), timerCount_(0),
+            inlineMaxBytes_(inlineMaxKB > 0 ? static_cast<size_t>(inlineMaxKB) * 1024 : 0),
+            deferAcceptS_(deferAcceptS), fastOpenQueue_(fastOpenQueue),
+            timer_(new HeapTimer()), threadpool_(new ThreadPool(threadNum)),
+            sqlExecutor_(sqlThreadNum > 0 ? new SqlExecutor(sqlThreadNum, MAX_SQL_PENDING) : nullptr),
+            hashExecutor_(sqlThreadNum > 0 && hashThreadNum > 0 ? new SqlExecutor(hashThreadNum, MAX_HASH_PENDING) : nullptr),
+            epoller_(new Epoller()), users_(MAX_FD), verifying_(0)
     {
+    /* 对端已关闭时写套接字返回EPIPE，不让SIGPIPE结束进程 */
+    signal(SIGPIPE, SIG_IGN);
     srcDir_ = getcwd(nullptr, 256);
     assert(srcDir_);
     strncat(srcDir_, "/resources/", 16);
     HttpConn::userCount = 0;
     HttpConn::srcDir = srcDir_;
-    SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum);
+    HttpConn::metricsPath = metricsPath_.c_str();
+    HttpConn::metricsOnAdmin = (metricsPort > 0);
+    HttpConn::slowRequestMs = slowRequestMs;
+    HttpConn::bufferMode = bufferMode;
+    HttpConn::idleBufferKB = idleBufferKB;
+    HttpRequest::deferVerify = static_cast<bool>(sqlExecutor_);
+    PasswordHash::iterations = pwdHashIterations;
+    string storeType = userStore ? userStore : "mysql";
+    if(!UserStore::Init(storeType, userStorePath ? userStorePath : "")) { isClose_ = true; }
+    if(UserStore::Type() == "mysql") {
+        SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum,
+                                      sqlMinConn, sqlAcquireTimeoutMs, sqlReadyConn);
+    }
+    /* 攒批的注册要等一批写完才有结果，没有SQL线程时会让工作线程阻塞等待，此时不攒批 */
+    if(!sqlExecutor_) { registerBatchMs = 0; }
+    RegisterBatcher::Instance()->Init(registerBatchMs, registerBatchRows);
+    UserCache::Instance()->Init(userCacheTtlS);
+    if(UserCache::Instance()->Enabled()) {
+        /* 用户名较多时加载耗时，放到后台，加载完成前Bloom过滤器不参与判断 */
+        std::thread([] { UserCache::Instance()->LoadNames(UserStore::Instance()); }).detach();
+    }
+    InitMetrics_();
+    /* 连接槽提前分配好，连接洪峰时accept路径上不再整块构造连接对象 */
+    int reservedConns = preallocConns > 0 ? users_.Reserve(preallocConns) : 0;
 
     InitEventMode_(trigMode);
-    if(!InitSocket_()) { isClose_ = true;}
+    if(!isClose_ && !InitSocket_()) { isClose_ = true;}
+    /* 验证结果经它交回反应堆线程，连接的关闭与复用只发生在反应堆线程上 */
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(wakeFd_ < 0 || !epoller_->AddFd(wakeFd_, EPOLLIN)) { isClose_ = true; }
 
     if(openLog) {
-        Log::Instance()->init(logLevel, "./log", ".log", logQueSize);
+        Log::Instance()->init(logLevel, "./log", ".log", logQueSize, logOverflow, logSampleRate,
+                              logMaxFileMB, logCompress);
         if(isClose_) { LOG_ERROR("========== Server init error!=========="); }
         else {
             LOG_INFO("========== Server init ==========");
             LOG_INFO("Port:%d, OpenLinger: %s", port_, OptLinger? "true":"false");
-            LOG_INFO("Listen Mode: %s, OpenConn Mode: %s",
+            LOG_INFO("Listen Mode: %s, OpenConn Mode: %s%s",
                             (listenEvent_ & EPOLLET ? "ET": "LT"),
-                            (connEvent_ & EPOLLET ? "ET": "LT"));
-            LOG_INFO("LogSys level: %d", logLevel);
+                            (connEvent_ & EPOLLET ? "ET": "LT"),
+                            (connEvent_ & EPOLLONESHOT ? "" : " (registered once)"));
+            LOG_INFO("LogSys level: %d, overflow policy: %d", logLevel, logOverflow);
+            LOG_INFO("Log rotate size: %dMB, compress: %s", logMaxFileMB, logCompress ? "true" : "false");
             LOG_INFO("srcDir: %s", HttpConn::srcDir);
-            LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolNum, threadNum);
+            LOG_INFO("User store: %s%s%s", storeType.c_str(), storeType == "sqlite" ? " " : "",
+                     storeType == "sqlite" ? userStorePath : "");
+            if(UserStore::Type() == "mysql") {
+                LOG_INFO("SqlConnPool num: %d (min %d, open %d), ThreadPool num: %d", connPoolNum,
+                         sqlMinConn < 0 ? connPoolNum : sqlMinConn, SqlConnPool::Instance()->GetConnCount(), threadNum);
+                LOG_INFO("SqlConnPool acquire timeout: %dms", sqlAcquireTimeoutMs);
+            } else {
+                LOG_INFO("ThreadPool num: %d", threadNum);
+            }
+            LOG_INFO("Metrics path: %s, admin port: %d", metricsPath_.c_str(), metricsPort_);
+            LOG_INFO("Slow request threshold: %dms", slowRequestMs);
+            LOG_INFO("Buffer: %s", bufferMode == HttpConn::BUFFER_RING ? "ring" :
+                                   (bufferMode == HttpConn::BUFFER_CHAIN ? "chain" : "vector"));
+            LOG_INFO("Inline process: %dKB%s", inlineMaxKB, inlineMaxKB > 0 ? "" : " (disabled)");
+            LOG_INFO("Defer accept: %ds%s, fast open queue: %d%s", deferAcceptS_, deferAcceptS_ > 0 ? "" : " (disabled)",
+                     fastOpenQueue_, fastOpenQueue_ > 0 ? "" : " (disabled)");
+            LOG_INFO("Prealloc conns: %d%s", reservedConns, reservedConns > 0 ? "" : " (on demand)");
+            LOG_INFO("Idle buffer keep: %dKB%s", idleBufferKB, idleBufferKB < 0 ? " (never release)" : "");
+            LOG_INFO("Sql executor threads: %d%s", sqlThreadNum, sqlThreadNum > 0 ? "" : " (verify on worker)");
+            LOG_INFO("Password hash iterations: %d%s, hash threads: %d", pwdHashIterations,
+                     pwdHashIterations > 0 ? "" : " (plaintext)", hashExecutor_ ? hashThreadNum : 0);
+            LOG_INFO("Register batch: %dms / %d rows%s", registerBatchMs, registerBatchRows,
+                     registerBatchMs > 0 ? "" : (sqlExecutor_ ? " (disabled)" : " (disabled, needs sql executor)"));
+            LOG_INFO("User cache ttl: %ds%s", userCacheTtlS, userCacheTtlS > 0 ? "" : " (disabled)");
         }
     }
 }
 
 WebServer::~WebServer() {
     close(listenFd_);
+    if(adminListenFd_ >= 0) { close(adminListenFd_); }
     isClose_ = true;
     free(srcDir_);
+    /* SQL线程、哈希线程上的回调捕获了this和连接：先让攒批线程写完，再等所有验证结果交回，之后才能析构成员 */
+    RegisterBatcher::Instance()->Close();
+    while(verifying_.load() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if(wakeFd_ >= 0) { close(wakeFd_); }
     SqlConnPool::Instance()->ClosePool();
 }
 
@@ -60,6 +137,11 @@ void WebServer::InitEventMode_(int trigMode) {
         listenEvent_ |= EPOLLET;
         connEvent_ |= EPOLLET;
         break;
+    case 4:
+        /* 连接只在建立时注册一次读写事件，写意愿在用户态记录，处理完请求不再epoll_ctl */
+        listenEvent_ |= EPOLLET;
+        connEvent_ = EPOLLRDHUP | EPOLLET | EPOLLIN | EPOLLOUT;
+        break;
     default:
         listenEvent_ |= EPOLLET;
         connEvent_ |= EPOLLET;
@@ -68,32 +150,92 @@ void WebServer::InitEventMode_(int trigMode) {
     HttpConn::isET = (connEvent_ & EPOLLET);
 }
 
+void WebServer::InitMetrics_() {
+    Metrics* metrics = Metrics::Instance();
+    metrics->RegisterGauge("webserver_active_connections", "Open client connections.",
+        []() { return static_cast<double>(HttpConn::userCount); });
+    metrics->RegisterGauge("webserver_timers", "Pending connection timers.",
+        [this]() { return static_cast<double>(timerCount_.load(std::memory_order_relaxed)); });
+    metrics->RegisterGauge("webserver_threadpool_queue_depth", "Tasks waiting in the thread pool.",
+        [this]() { return static_cast<double>(threadpool_->QueueSize()); });
+    metrics->RegisterGauge("webserver_sql_free_connections", "Idle connections in the SQL pool.",
+        []() { return static_cast<double>(SqlConnPool::Instance()->GetFreeConnCount()); });
+    metrics->RegisterGauge("webserver_sql_connections", "Open connections in the SQL pool, idle or in use.",
+        []() { return static_cast<double>(SqlConnPool::Instance()->GetConnCount()); });
+    metrics->RegisterGauge("webserver_sql_acquire_timeouts_total", "SQL pool acquires that timed out.",
+        []() { return static_cast<double>(SqlConnPool::Instance()->GetAcquireTimeouts()); }, true);
+    metrics->RegisterGauge("webserver_register_batches_total", "Batched registration writes to the database.",
+        []() { return static_cast<double>(RegisterBatcher::Instance()->Batches()); }, true);
+    metrics->RegisterGauge("webserver_register_batched_rows_total", "Registrations written through the batcher.",
+        []() { return static_cast<double>(RegisterBatcher::Instance()->Rows()); }, true);
+    metrics->RegisterGauge("webserver_user_cache_hits_total", "User verifications answered from the login cache.",
+        []() { return static_cast<double>(UserCache::Instance()->Hits()); }, true);
+    metrics->RegisterGauge("webserver_user_cache_misses_total", "User verifications not found in the login cache.",
+        []() { return static_cast<double>(UserCache::Instance()->Misses()); }, true);
+    metrics->RegisterGauge("webserver_user_bloom_skips_total", "Registrations that skipped the duplicate-name check.",
+        []() { return static_cast<double>(UserCache::Instance()->BloomSkips()); }, true);
+    metrics->RegisterGauge("webserver_log_dropped_total", "Log lines dropped on queue overflow.",
+        []() { return static_cast<double>(Log::Instance()->GetDropCount()); }, true);
+    metrics->RegisterGauge("webserver_sql_executor_pending", "User verifications queued or running on SQL threads.",
+        [this]() { return sqlExecutor_ ? static_cast<double>(sqlExecutor_->Pending()) : 0.0; });
+    metrics->RegisterGauge("webserver_hash_executor_pending", "Password hashes queued or running on hash threads.",
+        [this]() { return hashExecutor_ ? static_cast<double>(hashExecutor_->Pending()) : 0.0; });
+    metrics->RegisterGauge("webserver_chunk_pool_cached_bytes", "Bytes cached in the buffer chunk pool.",
+        []() { return static_cast<double>(ChunkPool::Instance()->CachedBytes()); });
+    metrics->RegisterGauge("webserver_chunk_pool_in_use_bytes", "Bytes of buffer chunks held by connections.",
+        []() { return static_cast<double>(ChunkPool::Instance()->InUseBytes()); });
+}
+
 void WebServer::Start() {
     int timeMS = -1;  /* epoll wait timeout == -1 无事件将阻塞 */
+    bool listenPending = false, adminListenPending = false;
     if(!isClose_) { LOG_INFO("========== Server start =========="); }
     while(!isClose_) {
         if(timeoutMS_ > 0) {
             timeMS = timer_->GetNextTick();
+            timerCount_.store(timer_->size(), std::memory_order_relaxed);
         }
-        int eventCnt = epoller_->Wait(timeMS);
+        /* 监听队列上一轮没取完：ET不会再通知，不等待直接接着取 */
+        int eventCnt = epoller_->Wait((listenPending || adminListenPending) ? 0 : timeMS);
+        if(listenPending) { listenPending = DealListen_(listenFd_, false); }
+        if(adminListenPending) { adminListenPending = DealListen_(adminListenFd_, true); }
         for(int i = 0; i < eventCnt; i++) {
-            /* 处理事件 */
-            int fd = epoller_->GetEventFd(i);
+            /* 处理事件：监听套接字按fd注册，data即fd；连接的data是打包后的连接指针 */
+            uint64_t data = epoller_->GetEventData(i);
             uint32_t events = epoller_->GetEvents(i);
-            if(fd == listenFd_) {
-                DealListen_();
+            if(data == static_cast<uint64_t>(listenFd_)) {
+                listenPending = DealListen_(listenFd_, false);
+                continue;
+            }
+            else if(adminListenFd_ >= 0 && data == static_cast<uint64_t>(adminListenFd_)) {
+                adminListenPending = DealListen_(adminListenFd_, true);
+                continue;
+            }
+            else if(data == static_cast<uint64_t>(wakeFd_)) {
+                RunPosted_();
+                continue;
+            }
+            if(ConnTable::IsStale(data)) {
+                /* 连接已关闭（fd可能已被新连接复用），丢弃旧事件 */
+                LOG_DEBUG("Stale event dropped");
+                continue;
+            }
+            HttpConn* client = ConnTable::Unpack(data, nullptr);
+            /* 交给其他线程期间的事件只记下，交还时按需让epoll重新报告 */
+            int missed = ((events & EPOLLOUT) ? HttpConn::WRITE_MISSED : 0) |
+                         ((events & ~EPOLLOUT) ? HttpConn::READ_MISSED : 0);
+            if(client->DeferIfOffloaded(missed)) { continue; }
+            if(!(connEvent_ & EPOLLONESHOT)) {
+                DealPersistent_(client, events);
             }
             else if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
-                assert(users_.count(fd) > 0);
-                CloseConn_(&users_[fd]);
+                CloseConn_(client);
             }
             else if(events & EPOLLIN) {
-                assert(users_.count(fd) > 0);
-                DealRead_(&users_[fd]);
+                DealRead_(client);
             }
             else if(events & EPOLLOUT) {
-                assert(users_.count(fd) > 0);
-                DealWrite_(&users_[fd]);
+                DealWrite_(client);
             } else {
                 LOG_ERROR("Unexpected event");
             }
@@ -110,49 +252,123 @@ void WebServer::SendError_(int fd, const char*info) {
     close(fd);
 }
 
+void WebServer::CloseOnReactor_(HttpConn* client) {
+    /* 工作线程还在使用的连接不能在这里关闭：fd释放后可能立即被accept复用到同一个连接对象上 */
+    if(client->DeferIfOffloaded(HttpConn::CLOSE_PENDING)) { return; }
+    CloseConn_(client);
+}
+
+void WebServer::CloseOwned_(HttpConn* client) {
+    if(!client->Offloaded()) {
+        CloseConn_(client);
+        return;
+    }
+    uint32_t generation = client->Generation();
+    client->Reclaim();
+    PostToReactor_([this, client, generation]() {
+        if(client->Generation() == generation) { CloseOnReactor_(client); }
+    });
+}
+
 void WebServer::CloseConn_(HttpConn* client) {
-    assert(client);
+    assert(client && !client->Offloaded());
     LOG_INFO("Client[%d] quit!", client->GetFd());
-    epoller_->DelFd(client->GetFd());
+    if(client->Registered()) { epoller_->DelFd(client->GetFd()); }
     client->Close();
 }
 
-void WebServer::AddClient_(int fd, sockaddr_in addr) {
+void WebServer::AddClient_(int fd, sockaddr_in addr, bool isAdmin) {
     assert(fd > 0);
-    users_[fd].init(fd, addr);
+    HttpConn* client = users_.Get(fd);
+    client->init(fd, addr, isAdmin);
     if(timeoutMS_ > 0) {
-        timer_->add(fd, timeoutMS_, std::bind(&WebServer::CloseConn_, this, &users_[fd]));
+        timer_->add(fd, timeoutMS_, std::bind(&WebServer::CloseOnReactor_, this, client));
+    }
+    if(!isAdmin && deferAcceptS_ > 0 && inlineMaxBytes_ > 0) {
+        /* 延迟accept时连接到达即已带着请求，先试读，读到就直接处理，省去一次等待EPOLLIN的往返 */
+        int readErrno = 0;
+        ssize_t ret = client->read(&readErrno);
+        if(ret <= 0 && readErrno != EAGAIN) {
+            CloseConn_(client);
+            return;
+        }
+        if(client->HasInput()) {
+            LOG_INFO("Client[%d] in!", client->GetFd());
+            /* ONESHOT时暂不注册，由处理结束时的Arm_注册，避免处理交给其他线程后反应堆线程又收到它的事件；
+               持久注册时交出标记会屏蔽这期间的事件 */
+            if(!(connEvent_ & EPOLLONESHOT)) {
+                epoller_->AddFd(fd, EPOLLIN | connEvent_, ConnTable::Pack(client));
+                client->SetRegistered(true);
+            }
+            ProcessInline_(client);
+            return;
+        }
     }
-    epoller_->AddFd(fd, EPOLLIN | connEvent_);
-    SetFdNonblock(fd);
-    LOG_INFO("Client[%d] in!", users_[fd].GetFd());
+    epoller_->AddFd(fd, EPOLLIN | connEvent_, ConnTable::Pack(client));
+    client->SetRegistered(true);
+    LOG_INFO("Client[%d] in!", client->GetFd());
 }
 
-void WebServer::DealListen_() {
+bool WebServer::DealListen_(int listenFd, bool isAdmin) {
     struct sockaddr_in addr;
     socklen_t len = sizeof(addr);
+    int accepted = 0;
     do {
-        int fd = accept(listenFd_, (struct sockaddr *)&addr, &len);
-        if(fd <= 0) { return;}
-        else if(HttpConn::userCount >= MAX_FD) {
+        /* 新连接直接带上非阻塞和close-on-exec，省去两次fcntl */
+        int fd = accept4(listenFd, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd <= 0) { return false;}
+        else if(HttpConn::userCount >= MAX_FD || fd >= MAX_FD) {
             SendError_(fd, "Server busy!");
             LOG_WARN("Clients is full!");
-            return;
+            return false;
         }
-        AddClient_(fd, addr);
+        Metrics::Instance()->Add(Metrics::ACCEPTS);
+        AddClient_(fd, addr, isAdmin);
+        /* 连接洪峰时一轮只取一部分，让已有连接的事件也能及时处理 */
+        if(++accepted >= MAX_ACCEPTS_PER_LOOP) { return (listenEvent_ & EPOLLET) != 0; }
     } while(listenEvent_ & EPOLLET);
+    return false;
+}
+
+void WebServer::DealPersistent_(HttpConn* client, uint32_t events) {
+    if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        CloseConn_(client);
+        return;
+    }
+    uint32_t generation = client->Generation();
+    if((events & EPOLLOUT) && client->WantWrite()) {
+        DealWrite_(client);
+    }
+    /* 写出时可能已关闭或交出了连接 */
+    if((events & EPOLLIN) && client->Generation() == generation && !client->Offloaded()) {
+        DealRead_(client);
+    }
 }
 
 void WebServer::DealRead_(HttpConn* client) {
     assert(client);
     ExtentTime_(client);
-    threadpool_->AddTask(std::bind(&WebServer::OnRead_, this, client));
+    if(inlineMaxBytes_ > 0) {
+        /* 非阻塞读在反应堆线程上与在工作线程上开销相同，省去一次线程切换 */
+        OnRead_(client, true);
+        return;
+    }
+    client->SetOffloaded(true);
+    client->MarkQueued();
+    threadpool_->AddTask(std::bind(&WebServer::OnRead_, this, client, false));
 }
 
 void WebServer::DealWrite_(HttpConn* client) {
     assert(client);
     ExtentTime_(client);
-    threadpool_->AddTask(std::bind(&WebServer::OnWrite_, this, client));
+    if(inlineMaxBytes_ > 0 && static_cast<size_t>(client->ToWriteBytes()) <= inlineMaxBytes_) {
+        OnWrite_(client, true);
+        return;
+    }
+    /* 大文件写出可能触发缺页读盘，交给线程池 */
+    client->SetOffloaded(true);
+    client->MarkQueued();
+    threadpool_->AddTask(std::bind(&WebServer::OnWrite_, this, client, false));
 }
 
 void WebServer::ExtentTime_(HttpConn* client) {
@@ -160,59 +376,280 @@ void WebServer::ExtentTime_(HttpConn* client) {
     if(timeoutMS_ > 0) { timer_->adjust(client->GetFd(), timeoutMS_); }
 }
 
-void WebServer::OnRead_(HttpConn* client) {
+void WebServer::OnRead_(HttpConn* client, bool onReactor) {
     assert(client);
+    if(!onReactor) { client->MarkDequeued(); }
     int ret = -1;
     int readErrno = 0;
     ret = client->read(&readErrno);
     if(ret <= 0 && readErrno != EAGAIN) {
-        CloseConn_(client);
+        CloseOwned_(client);
         return;
     }
-    OnProcess(client);
+    if(onReactor) {
+        ProcessInline_(client);
+    } else {
+        OnProcess(client);
+    }
+}
+
+void WebServer::ProcessInline_(HttpConn* client) {
+    /* 持久注册：上一个响应还没写完，写完后再处理已读到的请求 */
+    if(client->WantWrite()) { return; }
+    while(true) {
+        if(client->MayBlock()) {
+            client->SetOffloaded(true);
+            client->MarkQueued();
+            threadpool_->AddTask([this, client]() {
+                client->MarkDequeued();
+                OnProcess(client);
+            });
+            return;
+        }
+        /* 构建完响应直接写出，只在写不完时才等可写事件；流水线上的后续请求在循环中接着处理 */
+        if(!client->process()) {
+            if(client->NeedVerify()) {
+                Verify_(client);
+            } else {
+                client->ReleaseIdle();
+                Arm_(client, false);
+            }
+            return;
+        }
+        if(static_cast<size_t>(client->ToWriteBytes()) > inlineMaxBytes_) {
+            client->SetWantWrite(true);
+            DealWrite_(client);
+            return;
+        }
+        if(!FlushResponse_(client)) { return; }
+    }
 }
 
 void WebServer::OnProcess(HttpConn* client) {
-    if(client->process()) {
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+    /* 构建完响应直接写出，写完的长连接接着处理读缓冲区中的下一个请求 */
+    while(client->process()) {
+        if(!FlushResponse_(client)) { return; }
+    }
+    if(client->NeedVerify()) {
+        Verify_(client);
+    } else {
+        client->ReleaseIdle();
+        Arm_(client, false);
+    }
+}
+
+void WebServer::Arm_(HttpConn* client, bool write) {
+    /* 工作线程交还时先注册再放开：交出期间反应堆线程不会关闭连接，fd不会被复用，
+       注册后立即到来的事件被记下，由HandBack_交给反应堆线程补上 */
+    if(connEvent_ & EPOLLONESHOT) {
+        uint32_t events = connEvent_ | (write ? EPOLLOUT : EPOLLIN);
+        if(client->Registered()) {
+            epoller_->ModFd(client->GetFd(), events, ConnTable::Pack(client));
+        } else {
+            /* accept后试读直接处理的连接还没有注册 */
+            client->SetRegistered(true);
+            epoller_->AddFd(client->GetFd(), events, ConnTable::Pack(client));
+        }
     } else {
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN);
+        client->SetWantWrite(write);
+        if(!client->Offloaded()) { return; }
+        /* 持久注册：MOD会按套接字当前的状态重新报告就绪事件，交出期间被忽略的读、写、挂断都不会丢 */
+        epoller_->ModFd(client->GetFd(), connEvent_, ConnTable::Pack(client));
     }
+    HandBack_(client, write);
+}
+
+void WebServer::HandBack_(HttpConn* client, bool write) {
+    uint32_t generation = client->Generation();
+    int state = client->Reclaim();
+    bool missed = (state & HttpConn::READ_MISSED) || (write && (state & HttpConn::WRITE_MISSED));
+    if(!(state & HttpConn::CLOSE_PENDING) && !missed) { return; }
+    PostToReactor_([this, client, generation, state, write]() {
+        if(client->Generation() != generation) { return; }
+        if(state & HttpConn::CLOSE_PENDING) {
+            CloseOnReactor_(client);
+        } else if(connEvent_ & EPOLLONESHOT) {
+            /* 注册后、放开前到来的事件已被丢弃，重新注册让epoll再报告一次 */
+            Arm_(client, write);
+        } else if(!client->Offloaded()) {
+            epoller_->ModFd(client->GetFd(), connEvent_, ConnTable::Pack(client));
+        }
+    });
 }
 
-void WebServer::OnWrite_(HttpConn* client) {
+void WebServer::Verify_(HttpConn* client) {
+    /* 连接是ONESHOT的，验证期间不重新注册，连接上不会有其他任务（持久注册时标记为已交出）；
+       结果交回反应堆线程处理，期间的超时只记下，由OnVerified_关闭 */
+    client->SetOffloaded(true);
+    verifying_.fetch_add(1);
+    uint32_t generation = client->Generation();
+    std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+    if(hashExecutor_ || RegisterBatcher::Instance()->Enabled()) {
+        auto stages = std::make_shared<std::vector<HttpRequest::VerifyStage>>(client->VerifyStages());
+        VerifyStage_(client, generation, stages, 0, submitted);
+        return;
+    }
+    bool ok = sqlExecutor_->Submit(client->VerifyTask(),
+        [this, client, generation, submitted](bool result) {
+            Metrics::Instance()->Observe(Metrics::SQL_VERIFY, std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - submitted).count());
+            /* SQL线程只做查询，结果交回反应堆线程 */
+            VerifyDone_(client, generation, result);
+        });
+    if(!ok) {
+        LOG_WARN("Sql executor busy, Client[%d] verify rejected", client->GetFd());
+        VerifyDone_(client, generation, false);
+    }
+}
+
+void WebServer::VerifyStage_(HttpConn* client, uint32_t generation,
+                             std::shared_ptr<std::vector<HttpRequest::VerifyStage>> stages, size_t index,
+                             std::chrono::steady_clock::time_point submitted) {
+    const HttpRequest::VerifyStage& stage = (*stages)[index];
+    SqlExecutor::Query run = stage.run;
+    SqlExecutor* executor = sqlExecutor_.get();
+    if(stage.cpu && hashExecutor_) {
+        /* 哈希线程只做计算，记录排队和计算耗时 */
+        executor = hashExecutor_.get();
+        std::chrono::steady_clock::time_point queued = std::chrono::steady_clock::now();
+        run = [run, queued]() {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            Metrics::Instance()->Observe(Metrics::HASH_QUEUE_WAIT,
+                std::chrono::duration_cast<std::chrono::microseconds>(start - queued).count());
+            bool result = run();
+            Metrics::Instance()->Observe(Metrics::HASH_DURATION, std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+            return result;
+        };
+    }
+    auto done = [this, client, generation, stages, index, submitted](bool result) {
+        /* 前一阶段失败或连接已关闭就不再提交后续阶段 */
+        if(result && index + 1 < stages->size() && client->Generation() == generation) {
+            VerifyStage_(client, generation, stages, index + 1, submitted);
+            return;
+        }
+        Metrics::Instance()->Observe(Metrics::SQL_VERIFY, std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - submitted).count());
+        VerifyDone_(client, generation, result);
+    };
+    if(stage.async) {
+        stage.async(done);
+    } else if(!executor->Submit(run, done)) {
+        LOG_WARN("%s executor busy, Client[%d] verify rejected", executor == sqlExecutor_.get() ? "Sql" : "Hash",
+                 client->GetFd());
+        VerifyDone_(client, generation, false);
+    }
+}
+
+void WebServer::VerifyDone_(HttpConn* client, uint32_t generation, bool ok) {
+    PostToReactor_(std::bind(&WebServer::OnVerified_, this, client, generation, ok));
+    verifying_.fetch_sub(1);
+}
+
+void WebServer::OnVerified_(HttpConn* client, uint32_t generation, bool ok) {
+    /* 交出期间连接不会被关闭，代数不变；仍检查一次，防止结果交错到复用的连接上 */
+    if(client->Generation() != generation) {
+        LOG_DEBUG("Verify result dropped, connection closed");
+        return;
+    }
+    /* 验证期间超时的连接在这里关闭；持久注册时让epoll重新报告验证期间忽略的事件 */
+    int state = client->Reclaim();
+    if(state & HttpConn::CLOSE_PENDING) {
+        CloseConn_(client);
+        return;
+    }
+    if(!(connEvent_ & EPOLLONESHOT) && (state & (HttpConn::READ_MISSED | HttpConn::WRITE_MISSED))) {
+        epoller_->ModFd(client->GetFd(), connEvent_, ConnTable::Pack(client));
+    }
+    client->FinishVerify(ok);
+    /* 与其他响应一样直接写出，写不完才等可写事件 */
+    client->SetWantWrite(true);
+    DealWrite_(client);
+}
+
+void WebServer::PostToReactor_(std::function<void()> task) {
+    bool wake;
+    {
+        std::lock_guard<std::mutex> locker(postMtx_);
+        wake = posted_.empty();     /* 队列非空时反应堆线程必然还会来取，不必再唤醒 */
+        posted_.push_back(std::move(task));
+    }
+    if(wake) {
+        uint64_t one = 1;
+        if(write(wakeFd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            LOG_ERROR("Wake reactor error: %d", errno);
+        }
+    }
+}
+
+void WebServer::RunPosted_() {
+    uint64_t count = 0;
+    if(read(wakeFd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        LOG_ERROR("Read wake fd error: %d", errno);
+    }
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> locker(postMtx_);
+        tasks.swap(posted_);
+    }
+    for(auto& task : tasks) { task(); }
+}
+
+void WebServer::OnWrite_(HttpConn* client, bool onReactor) {
     assert(client);
-    int ret = -1;
+    if(!onReactor) { client->MarkDequeued(); }
+    if(!FlushResponse_(client)) { return; }
+    if(onReactor) {
+        ProcessInline_(client);
+    } else {
+        OnProcess(client);
+    }
+}
+
+bool WebServer::FlushResponse_(HttpConn* client) {
     int writeErrno = 0;
-    ret = client->write(&writeErrno);
+    ssize_t ret = client->write(&writeErrno);
     if(client->ToWriteBytes() == 0) {
         /* 传输完成 */
-        if(client->IsKeepAlive()) {
-            OnProcess(client);
-            return;
-        }
+        client->SetWantWrite(false);
+        if(client->IsKeepAlive()) { return true; }
     }
-    else if(ret < 0) {
-        if(writeErrno == EAGAIN) {
-            /* 继续传输 */
-            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
-            return;
-        }
+    else if(ret < 0 && writeErrno == EAGAIN) {
+        /* 继续传输 */
+        Arm_(client, true);
+        return false;
     }
-    CloseConn_(client);
+    CloseOwned_(client);
+    return false;
 }
 
 /* Create listenFd */
 bool WebServer::InitSocket_() {
-    int ret;
-    struct sockaddr_in addr;
     if(port_ > 65535 || port_ < 1024) {
         LOG_ERROR("Port:%d error!",  port_);
         return false;
     }
+    listenFd_ = OpenListenFd_(port_, false);
+    if(listenFd_ < 0) {
+        return false;
+    }
+    if(metricsPort_ > 0) {
+        adminListenFd_ = OpenListenFd_(metricsPort_, true);
+        if(adminListenFd_ < 0) {
+            close(listenFd_);
+            return false;
+        }
+    }
+    return true;
+}
+
+int WebServer::OpenListenFd_(int port, bool isAdmin) {
+    int ret;
+    struct sockaddr_in addr;
     addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(port_);
+    /* 管理端口只对本机开放，指标经反向代理或本机采集器抓取 */
+    addr.sin_addr.s_addr = htonl(isAdmin ? INADDR_LOOPBACK : INADDR_ANY);
+    addr.sin_port = htons(port);
     struct linger optLinger = { 0 };
     if(openLinger_) {
         /* 优雅关闭: 直到所剩数据发送完毕或超时 */
@@ -220,56 +657,69 @@ bool WebServer::InitSocket_() {
         optLinger.l_linger = 1;
     }
 
-    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if(listenFd_ < 0) {
-        LOG_ERROR("Create socket error!", port_);
-        return false;
+    int listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(listenFd < 0) {
+        LOG_ERROR("Create socket error!", port);
+        return -1;
     }
 
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
     if(ret < 0) {
-        close(listenFd_);
-        LOG_ERROR("Init linger error!", port_);
-        return false;
+        close(listenFd);
+        LOG_ERROR("Init linger error!", port);
+        return -1;
     }
 
     int optval = 1;
     /* 端口复用 */
     /* 只有最后一个套接字会正常接收数据。 */
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
     if(ret == -1) {
         LOG_ERROR("set socket setsockopt error !");
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
+    }
+
+    if(!isAdmin && deferAcceptS_ > 0) {
+        /* 三次握手完成后不立即唤醒，等客户端的首个请求数据到达再交给accept，最多等待deferAcceptS_秒 */
+        if(setsockopt(listenFd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &deferAcceptS_, sizeof(deferAcceptS_)) < 0) {
+            LOG_WARN("Set TCP_DEFER_ACCEPT error: %d", errno);
+        }
+    }
+    if(!isAdmin && fastOpenQueue_ > 0) {
+        /* 携带cookie的回访客户端可在SYN中带上请求，省去一次往返；需内核 net.ipv4.tcp_fastopen 开启服务端(0x2) */
+        if(setsockopt(listenFd, IPPROTO_TCP, TCP_FASTOPEN, &fastOpenQueue_, sizeof(fastOpenQueue_)) < 0) {
+            LOG_WARN("Set TCP_FASTOPEN error: %d", errno);
+        }
     }
 
-    ret = bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr));
+    ret = bind(listenFd, (struct sockaddr *)&addr, sizeof(addr));
     if(ret < 0) {
-        LOG_ERROR("Bind Port:%d error!", port_);
-        close(listenFd_);
-        return false;
+        LOG_ERROR("Bind Port:%d error!", port);
+        close(listenFd);
+        return -1;
     }
 
-    ret = listen(listenFd_, 6);
+    ret = listen(listenFd, 6);
     if(ret < 0) {
-        LOG_ERROR("Listen port:%d error!", port_);
-        close(listenFd_);
-        return false;
+        LOG_ERROR("Listen port:%d error!", port);
+        close(listenFd);
+        return -1;
     }
-    ret = epoller_->AddFd(listenFd_,  listenEvent_ | EPOLLIN);
+    ret = epoller_->AddFd(listenFd,  listenEvent_ | EPOLLIN);
     if(ret == 0) {
         LOG_ERROR("Add listen error!");
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
-    SetFdNonblock(listenFd_);
-    LOG_INFO("Server port:%d", port_);
-    return true;
+    SetFdNonblock(listenFd);
+    LOG_INFO("Server port:%d", port);
+    return listenFd;
 }
 
 int WebServer::SetFdNonblock(int fd) {
     assert(fd > 0);
-    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFD, 0) | O_NONBLOCK);
+    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
 }
 
 
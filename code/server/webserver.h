@@ -1,22 +1,28 @@
 #ifndef WEBSERVER_H
 #define WEBSERVER_H
 
-#include <unordered_map>
 #include <fcntl.h>       // fcntl()
 #include <unistd.h>      // close()
 #include <assert.h>
 #include <errno.h>
+#include <signal.h>      // signal()
+#include <sys/eventfd.h> // eventfd()
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h> // TCP_DEFER_ACCEPT TCP_FASTOPEN
 #include <arpa/inet.h>
 
 #include "epoller.h"
+#include "conntable.h"
 #include "../log/log.h"
 #include "../timer/heaptimer.h"
 #include "../pool/sqlconnpool.h"
 #include "../pool/threadpool.h"
+#include "../pool/sqlexecutor.h"
 #include "../pool/sqlconnRAII.h"
 #include "../http/httpconn.h"
+#include "../user/usercache.h"
+#include "../user/userstore.h"
 
 class WebServer {
 public:
@@ -24,29 +30,60 @@ public:
         int port, int trigMode, int timeoutMS, bool OptLinger, 
         int sqlPort, const char* sqlUser, const  char* sqlPwd, 
         const char* dbName, int connPoolNum, int threadNum,
-        bool openLog, int logLevel, int logQueSize);
+        bool openLog, int logLevel, int logQueSize,
+        int logOverflow = Log::OVERFLOW_DROP_OLDEST, int logSampleRate = 10,
+        int logMaxFileMB = 0, bool logCompress = false,
+        const char* metricsPath = "", int metricsPort = 0,
+        int slowRequestMs = 0, int bufferMode = HttpConn::BUFFER_VECTOR,
+        int idleBufferKB = -1, int sqlThreadNum = 0,
+        int sqlMinConn = -1, int sqlAcquireTimeoutMs = 1000, int sqlReadyConn = -1,
+        int userCacheTtlS = 0, int hashThreadNum = 0, int pwdHashIterations = 0,
+        int registerBatchMs = 0, int registerBatchRows = 64,
+        const char* userStore = "mysql", const char* userStorePath = "./users.db",
+        int inlineMaxKB = 0, int preallocConns = 0,
+        int deferAcceptS = 0, int fastOpenQueue = 0);
 
     ~WebServer();
     void Start();
 
 private:
     bool InitSocket_();           // 初始化监听套接字
+    int OpenListenFd_(int port, bool isAdmin);  // 创建并注册一个监听套接字，失败返回-1
     void InitEventMode_(int trigMode);  // 初始化事件触发模式
-    void AddClient_(int fd, sockaddr_in addr);  // 添加新客户端连接
+    void InitMetrics_();          // 注册抓取时求值的运行指标
+    void AddClient_(int fd, sockaddr_in addr, bool isAdmin);  // 添加新客户端连接
   
-    void DealListen_();           // 处理监听套接字事件（新连接）
+    bool DealListen_(int listenFd, bool isAdmin);  // 处理监听套接字事件（新连接），达到单轮上限还有剩余时返回true
     void DealWrite_(HttpConn* client);   // 处理写事件
     void DealRead_(HttpConn* client);    // 处理读事件
 
     void SendError_(int fd, const char* info);   // 发送错误信息
     void ExtentTime_(HttpConn* client);          // 延长连接超时时间
-    void CloseConn_(HttpConn* client);           // 关闭客户端连接
+    void CloseConn_(HttpConn* client);           // 关闭客户端连接，只在反应堆线程上对未交出的连接调用
+    void CloseOnReactor_(HttpConn* client);      // 反应堆线程发起的关闭（如超时）：连接已交出时只记下，交还后再关
+    void CloseOwned_(HttpConn* client);          // 持有连接的线程关闭连接：工作线程上交还后把关闭交给反应堆线程
 
-    void OnRead_(HttpConn* client);      // 处理读事件的具体逻辑
-    void OnWrite_(HttpConn* client);     // 处理写事件的具体逻辑
+    void OnRead_(HttpConn* client, bool onReactor);   // 处理读事件的具体逻辑，onReactor表示在反应堆线程上内联执行
+    void OnWrite_(HttpConn* client, bool onReactor);  // 处理写事件的具体逻辑
+    bool FlushResponse_(HttpConn* client);  // 写出响应，写完且为长连接时返回true；写不完时等可写，出错或短连接写完时关闭
     void OnProcess(HttpConn* client);    // 处理HTTP请求
+    void ProcessInline_(HttpConn* client);  // 内联模式：廉价请求就地处理，可能阻塞的交给线程池
+    void DealPersistent_(HttpConn* client, uint32_t events);  // 持久注册（mode 4）的连接事件
+    void Arm_(HttpConn* client, bool write);  // 等待下一次读或写：ONESHOT时重新注册，持久注册时记录写意愿
+    void HandBack_(HttpConn* client, bool write);  // 交还连接，交出期间记下的超时和事件交给反应堆线程处理
+    void Verify_(HttpConn* client);      // 把用户验证交给SQL线程，期间连接不注册任何事件
+    void VerifyStage_(HttpConn* client, uint32_t generation,
+                      std::shared_ptr<std::vector<HttpRequest::VerifyStage>> stages, size_t index,
+                      std::chrono::steady_clock::time_point submitted);  // 提交第index个验证阶段，按类型交给SQL线程或哈希线程
+    void VerifyDone_(HttpConn* client, uint32_t generation, bool ok);  // 验证结束（任意线程），把结果交回反应堆线程
+    void OnVerified_(HttpConn* client, uint32_t generation, bool ok);  // 在反应堆线程上恢复连接
+    void PostToReactor_(std::function<void()> task);  // 把任务交给反应堆线程执行（任意线程调用）
+    void RunPosted_();                                // 反应堆线程：执行其他线程交来的任务
 
     static const int MAX_FD = 65536;
+    static const int MAX_ACCEPTS_PER_LOOP = 64; // 每轮事件循环最多接受的新连接数
+    static const int MAX_SQL_PENDING = 4096;    // SQL线程排队和执行中的验证上限，超过直接按失败处理
+    static const int MAX_HASH_PENDING = 1024;   // 哈希线程排队和执行中的口令哈希上限，登录突发时超出部分直接失败
 
     static int SetFdNonblock(int fd);
 
@@ -55,15 +92,29 @@ private:
     int timeoutMS_;               // 连接超时时间（毫秒）
     bool isClose_;                // 服务器是否关闭
     int listenFd_;                // 监听套接字文件描述符
+    std::string metricsPath_;     // 指标路径，空表示不提供指标
+    int metricsPort_;             // 管理端口(只监听127.0.0.1)，0表示指标与业务共用端口
+    int adminListenFd_;           // 管理端口监听套接字
+    int wakeFd_;                  // 其他线程交来任务时唤醒反应堆线程的eventfd
+    std::atomic<size_t> timerCount_;  // 主线程维护的定时器数量快照
     char* srcDir_;                // 静态资源目录路径
+    size_t inlineMaxBytes_;       // 内联模式下在反应堆线程写出的响应上限，0表示所有请求都交给线程池
+    int deferAcceptS_;            // 业务端口TCP_DEFER_ACCEPT的等待秒数，0为关闭
+    int fastOpenQueue_;           // 业务端口TCP_FASTOPEN的队列长度，0为关闭
     
     uint32_t listenEvent_;        // 监听套接字的事件类型
     uint32_t connEvent_;          // 连接套接字的事件类型
    
     std::unique_ptr<HeapTimer> timer_;           // 定时器（管理连接超时）
     std::unique_ptr<ThreadPool> threadpool_;     // 线程池（处理HTTP请求）
+    std::unique_ptr<SqlExecutor> sqlExecutor_;   // 执行用户验证的SQL线程，为空时在工作线程上同步验证
+    std::unique_ptr<SqlExecutor> hashExecutor_;  // 计算口令哈希的线程，为空时在SQL线程上随查询一起计算
     std::unique_ptr<Epoller> epoller_;           // epoll事件监听器
-    std::unordered_map<int, HttpConn> users_;    // 客户端连接映射表
+    ConnTable users_;                            // 客户端连接表（按fd下标索引）
+
+    std::mutex postMtx_;
+    std::vector<std::function<void()>> posted_;  // 等待反应堆线程执行的任务
+    std::atomic<int> verifying_;                 // 已提交、结果还没交回反应堆线程的验证数，析构时等它归零
 };
 
 
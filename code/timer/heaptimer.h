@@ -44,6 +44,8 @@ public:
 
     int GetNextTick(); //获取下一个定时器的到期时间
 
+    size_t size() const { return heap_.size(); } //当前定时器数量
+
 private:
     void del_(size_t i); //删除指定位置的节点
     
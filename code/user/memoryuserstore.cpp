@@ -0,0 +1,65 @@
+#include "memoryuserstore.h"
+#include <stdlib.h>
+#include <new>
+
+using namespace std;
+
+const int MemoryUserStore::STRIPE_NUM;
+
+void* MemoryUserStore::operator new(size_t size) {
+    void* mem = nullptr;
+    if(posix_memalign(&mem, alignof(MemoryUserStore), size) != 0) {
+        throw std::bad_alloc();
+    }
+    return mem;
+}
+
+void MemoryUserStore::operator delete(void* ptr) {
+    free(ptr);
+}
+
+MemoryUserStore::Stripe& MemoryUserStore::StripeOf_(const string& name) {
+    return stripes_[hash<string>()(name) % STRIPE_NUM];
+}
+
+int MemoryUserStore::Fetch(const string& name, string& stored) {
+    Stripe& stripe = StripeOf_(name);
+    lock_guard<mutex> locker(stripe.mtx);
+    auto it = stripe.users.find(name);
+    if(it == stripe.users.end()) { return 0; }
+    stored = it->second;
+    return 1;
+}
+
+void MemoryUserStore::Insert(const vector<NewUser>& users, vector<char>& ok) {
+    ok.assign(users.size(), 0);
+    for(size_t i = 0; i < users.size(); i++) {
+        Stripe& stripe = StripeOf_(users[i].name);
+        lock_guard<mutex> locker(stripe.mtx);
+        ok[i] = stripe.users.emplace(users[i].name, users[i].stored).second;
+    }
+}
+
+long MemoryUserStore::Count() {
+    long count = 0;
+    for(Stripe& stripe : stripes_) {
+        lock_guard<mutex> locker(stripe.mtx);
+        count += static_cast<long>(stripe.users.size());
+    }
+    return count;
+}
+
+bool MemoryUserStore::ForEachName(const function<void(const string&)>& fn) {
+    /* 逐段复制出用户名后再回调，不在持锁时执行外部代码 */
+    vector<string> names;
+    for(Stripe& stripe : stripes_) {
+        {
+            lock_guard<mutex> locker(stripe.mtx);
+            names.reserve(stripe.users.size());
+            for(const auto& user : stripe.users) { names.push_back(user.first); }
+        }
+        for(const string& name : names) { fn(name); }
+        names.clear();
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef MEMORY_USER_STORE_H
+#define MEMORY_USER_STORE_H
+
+#include <mutex>
+#include <unordered_map>
+#include "userstore.h"
+
+/*
+ * 内存后端：按用户名散列到若干段，每段一把锁，不同段的读写互不阻塞
+ * 数据不落盘，用于在没有数据库的机器上压测请求路径本身的开销
+ */
+class MemoryUserStore : public UserStore {
+public:
+    int Fetch(const std::string& name, std::string& stored) override;
+    void Insert(const std::vector<NewUser>& users, std::vector<char>& ok) override;
+    long Count() override;
+    bool ForEachName(const std::function<void(const std::string&)>& fn) override;
+    bool UniqueNames() override { return true; }
+
+    /* C++11 的 new 不保证超过16字节的对齐，按缓存行对齐分配 */
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+
+private:
+    static const int STRIPE_NUM = 64;
+
+    struct alignas(64) Stripe {
+        std::mutex mtx;
+        std::unordered_map<std::string, std::string> users;  // 用户名 -> 口令记录
+    };
+
+    Stripe& StripeOf_(const std::string& name);
+
+    Stripe stripes_[STRIPE_NUM];
+};
+
+#endif //MEMORY_USER_STORE_H
@@ -0,0 +1,232 @@
+#include "mysqluserstore.h"
+#include <string.h>
+#include <unordered_set>
+#include <unordered_map>
+#include "../pool/sqlconnpool.h"
+#include "../pool/sqlconnRAII.h"
+#include "../log/log.h"
+
+using namespace std;
+
+/* 以字符串类型绑定一个参数或结果列 */
+static void BindString(MYSQL_BIND& bind, char* buffer, unsigned long bufferLen, unsigned long* length) {
+    memset(&bind, 0, sizeof(bind));
+    bind.buffer_type = MYSQL_TYPE_STRING;
+    bind.buffer = buffer;
+    bind.buffer_length = bufferLen;
+    bind.length = length;
+}
+
+/* 语句按连接缓存，参数个数取2的幂，每种语句在每个连接上最多缓存log2(批大小)+1条 */
+static size_t FloorPow2(size_t n) {
+    size_t p = 1;
+    while(p * 2 <= n) { p *= 2; }
+    return p;
+}
+
+int MysqlUserStore::Fetch(const string& name, string& stored) {
+    MYSQL* sql;
+    SqlConnRAII sql_conn_(&sql,  SqlConnPool::Instance());
+    if(!sql) { return -1; }  /* 等待超时或数据库不可达 */
+
+    /* 语句在每个连接上只预处理一次，参数以二进制绑定，不拼接SQL */
+    SqlConnPool* pool = SqlConnPool::Instance();
+    MYSQL_STMT* stmt = pool->GetStmt(sql, "SELECT password FROM user WHERE username=? LIMIT 1");
+    if(!stmt) { return -1; }
+
+    unsigned long nameLen = name.size();
+    MYSQL_BIND param[1];
+    BindString(param[0], const_cast<char*>(name.data()), nameLen, &nameLen);
+
+    char password[256];
+    unsigned long passwordLen = 0;
+    MYSQL_BIND result[1];
+    BindString(result[0], password, sizeof(password), &passwordLen);
+
+    if(mysql_stmt_bind_param(stmt, param) || mysql_stmt_execute(stmt) ||
+       mysql_stmt_bind_result(stmt, result) || mysql_stmt_store_result(stmt)) {
+        LOG_ERROR("Select error: %s", mysql_stmt_error(stmt));
+        pool->ResetStmts(sql);
+        return -1;
+    }
+    int ret = mysql_stmt_fetch(stmt);
+    mysql_stmt_free_result(stmt);
+    if(ret == MYSQL_NO_DATA) { return 0; }
+    /* 记录超过缓冲区时为MYSQL_DATA_TRUNCATED，用户存在但口令必然不匹配，留空让验证失败 */
+    stored.clear();
+    if(ret == 0) { stored.assign(password, passwordLen); }
+    return (ret == 0 || ret == MYSQL_DATA_TRUNCATED) ? 1 : -1;
+}
+
+/* 查出names中已存在的用户名，出错返回false */
+static bool SelectExisting(MYSQL* sql, const vector<const string*>& names, unordered_set<string>& existing) {
+    SqlConnPool* pool = SqlConnPool::Instance();
+    for(size_t begin = 0; begin < names.size(); ) {
+        /* 取不小于剩余个数的2的幂，不足的位置重复最后一个名字 */
+        size_t left = names.size() - begin;
+        size_t arity = FloorPow2(left);
+        if(arity < left) { arity *= 2; }
+        size_t n = min(left, arity);
+        string query = "SELECT username FROM user WHERE username IN (?";
+        for(size_t i = 1; i < arity; i++) { query += ",?"; }
+        query += ")";
+        MYSQL_STMT* stmt = pool->GetStmt(sql, query.c_str());
+        if(!stmt) { return false; }
+
+        vector<MYSQL_BIND> params(arity);
+        vector<unsigned long> lens(arity);
+        for(size_t i = 0; i < arity; i++) {
+            const string* name = names[begin + min(i, n - 1)];
+            lens[i] = name->size();
+            BindString(params[i], const_cast<char*>(name->data()), lens[i], &lens[i]);
+        }
+        char username[256];
+        unsigned long usernameLen = 0;
+        MYSQL_BIND result[1];
+        BindString(result[0], username, sizeof(username), &usernameLen);
+        if(mysql_stmt_bind_param(stmt, params.data()) || mysql_stmt_execute(stmt) ||
+           mysql_stmt_bind_result(stmt, result) || mysql_stmt_store_result(stmt)) {
+            LOG_ERROR("Batch select error: %s", mysql_stmt_error(stmt));
+            pool->ResetStmts(sql);
+            return false;
+        }
+        int ret;
+        while((ret = mysql_stmt_fetch(stmt)) == 0 || ret == MYSQL_DATA_TRUNCATED) {
+            existing.insert(string(username, min<unsigned long>(usernameLen, sizeof(username))));
+        }
+        mysql_stmt_free_result(stmt);
+        begin += n;
+    }
+    return true;
+}
+
+/* 写入rows中的用户，多行时在一个事务内分成若干个2的幂大小的多行INSERT，全部成功返回true */
+static bool InsertRows(MYSQL* sql, const vector<const UserStore::NewUser*>& rows) {
+    SqlConnPool* pool = SqlConnPool::Instance();
+    bool txn = rows.size() > 1;
+    if(txn && mysql_autocommit(sql, 0)) { return false; }
+    bool ok = true;
+    for(size_t begin = 0; ok && begin < rows.size(); ) {
+        size_t n = FloorPow2(rows.size() - begin);
+        string query = "INSERT INTO user(username, password) VALUES(?,?)";
+        for(size_t i = 1; i < n; i++) { query += ",(?,?)"; }
+        MYSQL_STMT* stmt = pool->GetStmt(sql, query.c_str());
+        if(!stmt) {
+            ok = false;
+            break;
+        }
+        vector<MYSQL_BIND> params(n * 2);
+        vector<unsigned long> lens(n * 2);
+        for(size_t i = 0; i < n; i++) {
+            const UserStore::NewUser* user = rows[begin + i];
+            lens[i * 2] = user->name.size();
+            lens[i * 2 + 1] = user->stored.size();
+            BindString(params[i * 2], const_cast<char*>(user->name.data()), lens[i * 2], &lens[i * 2]);
+            BindString(params[i * 2 + 1], const_cast<char*>(user->stored.data()), lens[i * 2 + 1], &lens[i * 2 + 1]);
+        }
+        if(mysql_stmt_bind_param(stmt, params.data()) || mysql_stmt_execute(stmt)) {
+            LOG_DEBUG("Insert error: %s", mysql_stmt_error(stmt));
+            pool->ResetStmts(sql);
+            ok = false;
+        }
+        begin += n;
+    }
+    if(txn) {
+        if(ok) { ok = !mysql_commit(sql); }
+        if(!ok) { mysql_rollback(sql); }
+        mysql_autocommit(sql, 1);
+    }
+    return ok;
+}
+
+void MysqlUserStore::Insert(const vector<NewUser>& users, vector<char>& ok) {
+    ok.assign(users.size(), 0);
+    MYSQL* sql;
+    SqlConnRAII sql_conn_(&sql, SqlConnPool::Instance());
+    if(!sql) { return; }
+
+    vector<const string*> check;
+    for(const NewUser& user : users) {
+        if(user.check) { check.push_back(&user.name); }
+    }
+    unordered_set<string> existing;
+    if(!SelectExisting(sql, check, existing)) { return; }
+
+    vector<size_t> index;
+    vector<const NewUser*> rows;
+    for(size_t i = 0; i < users.size(); i++) {
+        if(existing.count(users[i].name)) { continue; }
+        index.push_back(i);
+        rows.push_back(&users[i]);
+    }
+    if(InsertRows(sql, rows)) {
+        for(size_t i : index) { ok[i] = 1; }
+    } else if(rows.size() > 1) {
+        /* 整批失败（如其他实例同时注册了同名用户），逐行重试以区分各自的结果 */
+        for(size_t k = 0; k < rows.size(); k++) {
+            ok[index[k]] = InsertRows(sql, vector<const NewUser*>(1, rows[k]));
+        }
+    }
+}
+
+long MysqlUserStore::Count() {
+    MYSQL* sql;
+    SqlConnRAII sql_conn_(&sql, SqlConnPool::Instance());
+    if(!sql) { return -1; }
+    long count = -1;
+    if(mysql_query(sql, "SELECT COUNT(*) FROM user") == 0) {
+        MYSQL_RES* res = mysql_store_result(sql);
+        if(res) {
+            MYSQL_ROW row = mysql_fetch_row(res);
+            if(row && row[0]) { count = strtol(row[0], nullptr, 10); }
+            mysql_free_result(res);
+        }
+    }
+    return count;
+}
+
+bool MysqlUserStore::ForEachName(const function<void(const string&)>& fn) {
+    MYSQL* sql;
+    SqlConnRAII sql_conn_(&sql, SqlConnPool::Instance());
+    if(!sql) { return false; }
+    /* 逐行读取，不把整张表缓存在客户端 */
+    if(mysql_query(sql, "SELECT username FROM user") != 0) { return false; }
+    MYSQL_RES* res = mysql_use_result(sql);
+    if(!res) { return false; }
+    while(MYSQL_ROW row = mysql_fetch_row(res)) {
+        if(row[0]) { fn(row[0]); }
+    }
+    bool ok = (mysql_errno(sql) == 0);
+    mysql_free_result(res);
+    return ok;
+}
+
+bool MysqlUserStore::UniqueNames() {
+    int unique = unique_.load(memory_order_acquire);
+    if(unique >= 0) { return unique == 1; }
+    MYSQL* sql;
+    SqlConnRAII sql_conn_(&sql, SqlConnPool::Instance());
+    if(!sql) { return false; }  /* 暂时查不到，按没有处理，下次再查 */
+    MYSQL_RES* res = nullptr;
+    if(mysql_query(sql, "SHOW INDEX FROM user WHERE Non_unique=0") != 0 || !(res = mysql_store_result(sql))) {
+        /* 查询本身失败就不再重试，一直按没有唯一约束处理 */
+        LOG_WARN("Show index error: %s, duplicate check always on", mysql_error(sql));
+        unique_.store(0, memory_order_release);
+        return false;
+    }
+    /* 只有恰好由username一列组成的唯一索引（或主键）才能拒绝同名；列依次为 Table Non_unique Key_name Seq_in_index Column_name */
+    unordered_map<string, pair<int, bool>> keys;
+    while(MYSQL_ROW row = mysql_fetch_row(res)) {
+        if(!row[2] || !row[4]) { continue; }
+        pair<int, bool>& key = keys[row[2]];
+        key.first++;
+        key.second = key.second || strcmp(row[4], "username") == 0;
+    }
+    unique = 0;
+    for(const auto& key : keys) {
+        if(key.second.first == 1 && key.second.second) { unique = 1; }
+    }
+    mysql_free_result(res);
+    unique_.store(unique, memory_order_release);
+    return unique == 1;
+}
@@ -0,0 +1,24 @@
+#ifndef MYSQL_USER_STORE_H
+#define MYSQL_USER_STORE_H
+
+#include <atomic>
+#include "userstore.h"
+
+/* MySQL后端：经SqlConnPool取连接，使用按连接缓存的预处理语句 */
+class MysqlUserStore : public UserStore {
+public:
+    int Fetch(const std::string& name, std::string& stored) override;
+    /* 一个连接、一个事务内完成整批：一次 SELECT ... IN 查重，多行INSERT写入；整批失败时逐行重试 */
+    void Insert(const std::vector<NewUser>& users, std::vector<char>& ok) override;
+    long Count() override;
+    bool ForEachName(const std::function<void(const std::string&)>& fn) override;
+    /* 第一次调用时查 user 表在username上有没有唯一索引（原建表语句没有），查到结果后不再查 */
+    bool UniqueNames() override;
+
+    MysqlUserStore() : unique_(-1) {}
+
+private:
+    std::atomic<int> unique_;       // -1未知，0没有，1有
+};
+
+#endif //MYSQL_USER_STORE_H
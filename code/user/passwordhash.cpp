@@ -0,0 +1,124 @@
+#include "passwordhash.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <algorithm>
+#include "sha256.h"
+
+using namespace std;
+
+int PasswordHash::iterations = 0;
+
+const size_t PasswordHash::SALT_SIZE;
+const size_t PasswordHash::KEY_SIZE;
+const char PasswordHash::PREFIX[] = "pbkdf2_sha256$";
+
+static const size_t BLOCK_SIZE = 64;
+
+/* HMAC的内外两层在补齐密钥后的状态只与密钥有关，算一次后每轮复制即可，每轮只剩两次压缩 */
+struct HmacKey {
+    Sha256 inner, outer;
+
+    explicit HmacKey(const string& key) {
+        uint8_t block[BLOCK_SIZE] = {0};
+        if(key.size() > BLOCK_SIZE) {
+            string digest = Sha256::Hash(key);
+            memcpy(block, digest.data(), digest.size());
+        } else {
+            memcpy(block, key.data(), key.size());
+        }
+        uint8_t ipad[BLOCK_SIZE], opad[BLOCK_SIZE];
+        for(size_t i = 0; i < BLOCK_SIZE; i++) {
+            ipad[i] = block[i] ^ 0x36;
+            opad[i] = block[i] ^ 0x5c;
+        }
+        inner.Update(ipad, BLOCK_SIZE);
+        outer.Update(opad, BLOCK_SIZE);
+    }
+
+    void Mac(const uint8_t* data, size_t len, uint8_t out[Sha256::DIGEST_SIZE]) const {
+        Sha256 in = inner;
+        in.Update(data, len);
+        in.Final(out);
+        Sha256 o = outer;
+        o.Update(out, Sha256::DIGEST_SIZE);
+        o.Final(out);
+    }
+};
+
+string PasswordHash::Pbkdf2(const string& pwd, const string& salt, int iter, size_t keyLen) {
+    HmacKey key(pwd);
+    string out;
+    out.reserve(keyLen);
+    for(uint32_t blockIndex = 1; out.size() < keyLen; blockIndex++) {
+        /* U1 = HMAC(P, S || INT(i))，Uj = HMAC(P, Uj-1)，块 = U1 ^ ... ^ Uc */
+        string first = salt;
+        first += static_cast<char>(blockIndex >> 24);
+        first += static_cast<char>(blockIndex >> 16);
+        first += static_cast<char>(blockIndex >> 8);
+        first += static_cast<char>(blockIndex);
+        uint8_t u[Sha256::DIGEST_SIZE], t[Sha256::DIGEST_SIZE];
+        key.Mac(reinterpret_cast<const uint8_t*>(first.data()), first.size(), u);
+        memcpy(t, u, sizeof(t));
+        for(int j = 1; j < iter; j++) {
+            key.Mac(u, sizeof(u), u);
+            for(size_t k = 0; k < sizeof(t); k++) { t[k] ^= u[k]; }
+        }
+        out.append(reinterpret_cast<char*>(t), min(sizeof(t), keyLen - out.size()));
+    }
+    return out;
+}
+
+static string FromHex(const string& hex) {
+    string out;
+    if(hex.size() % 2) { return out; }
+    for(size_t i = 0; i < hex.size(); i += 2) {
+        char byte[3] = {hex[i], hex[i + 1], 0};
+        char* end = nullptr;
+        long v = strtol(byte, &end, 16);
+        if(*end) { return string(); }
+        out += static_cast<char>(v);
+    }
+    return out;
+}
+
+string PasswordHash::Hash(const string& pwd) {
+    if(iterations <= 0) { return pwd; }
+    random_device rd;
+    string salt;
+    while(salt.size() < SALT_SIZE) {
+        uint32_t r = rd();
+        salt.append(reinterpret_cast<const char*>(&r), min(sizeof(r), SALT_SIZE - salt.size()));
+    }
+    return PREFIX + to_string(iterations) + "$" + Sha256::Hex(salt) + "$" +
+           Sha256::Hex(Pbkdf2(pwd, salt, iterations, KEY_SIZE));
+}
+
+bool PasswordHash::IsHashed(const string& stored) {
+    return stored.compare(0, sizeof(PREFIX) - 1, PREFIX) == 0;
+}
+
+bool PasswordHash::Verify(const string& pwd, const string& stored) {
+    string expect, actual;
+    if(IsHashed(stored)) {
+        /* 迭代次数$盐$摘要 */
+        size_t iterEnd = stored.find('$', sizeof(PREFIX) - 1);
+        size_t saltEnd = (iterEnd == string::npos) ? string::npos : stored.find('$', iterEnd + 1);
+        if(saltEnd == string::npos) { return false; }
+        int iter = atoi(stored.c_str() + sizeof(PREFIX) - 1);
+        string salt = FromHex(stored.substr(iterEnd + 1, saltEnd - iterEnd - 1));
+        expect = FromHex(stored.substr(saltEnd + 1));
+        if(iter <= 0 || salt.empty() || expect.empty()) { return false; }
+        actual = Pbkdf2(pwd, salt, iter, expect.size());
+    } else {
+        expect = stored;
+        actual = pwd;
+    }
+    if(expect.size() != actual.size()) { return false; }
+    unsigned char diff = 0;
+    for(size_t i = 0; i < expect.size(); i++) {
+        diff |= static_cast<unsigned char>(expect[i] ^ actual[i]);
+    }
+    return diff == 0;
+}
@@ -0,0 +1,28 @@
+#ifndef PASSWORD_HASH_H
+#define PASSWORD_HASH_H
+
+#include <string>
+
+/*
+ * 口令的慢哈希（PBKDF2-HMAC-SHA256），user表中保存为 pbkdf2_sha256$迭代次数$盐(hex)$摘要(hex)，约120字节
+ * 单次计算耗时为毫秒级，登录/注册时应在专门的哈希线程上执行，不要占用处理I/O的线程
+ * 不是该格式的记录按明文口令比较，迭代次数调整前写入的记录按记录中的次数验证
+ */
+class PasswordHash {
+public:
+    static int iterations;      // 新口令的迭代次数，<=0时按明文保存（兼容旧表结构）
+
+    static std::string Hash(const std::string& pwd);                            // 生成随机盐并计算，返回要保存的记录
+    static bool Verify(const std::string& pwd, const std::string& stored);      // 比较耗时与口令是否正确无关
+    static bool IsHashed(const std::string& stored);                            // 记录是否为哈希格式（否则为明文）
+
+    static std::string Pbkdf2(const std::string& pwd, const std::string& salt,
+                              int iter, size_t keyLen);                         // 返回二进制的派生密钥
+
+private:
+    static const size_t SALT_SIZE = 16;
+    static const size_t KEY_SIZE = 32;
+    static const char PREFIX[];
+};
+
+#endif //PASSWORD_HASH_H
@@ -0,0 +1,112 @@
+#include "registerbatcher.h"
+#include <chrono>
+#include <future>
+#include <unordered_set>
+#include "usercache.h"
+#include "userstore.h"
+#include "../log/log.h"
+
+using namespace std;
+
+RegisterBatcher::RegisterBatcher() : windowMs_(0), maxRows_(1), running_(false), closing_(false),
+    batches_(0), rows_(0) {}
+
+RegisterBatcher::~RegisterBatcher() {
+    Close();
+}
+
+RegisterBatcher* RegisterBatcher::Instance() {
+    static RegisterBatcher batcher;
+    return &batcher;
+}
+
+void RegisterBatcher::Init(int windowMs, int maxRows) {
+    if(running_ || windowMs <= 0) { return; }
+    windowMs_ = windowMs;
+    maxRows_ = maxRows > 0 ? maxRows : 1;
+    closing_ = false;
+    running_ = true;
+    worker_ = thread(&RegisterBatcher::Run_, this);
+}
+
+void RegisterBatcher::Close() {
+    {
+        lock_guard<mutex> locker(mtx_);
+        if(!running_) { return; }
+        closing_ = true;
+    }
+    cond_.notify_all();
+    worker_.join();
+    running_ = false;
+}
+
+void RegisterBatcher::Submit(const string& name, const string& stored, Callback done) {
+    {
+        lock_guard<mutex> locker(mtx_);
+        if(running_ && !closing_) {
+            queue_.push_back({name, stored, std::move(done)});
+            if(queue_.size() == 1 || queue_.size() >= maxRows_) { cond_.notify_one(); }
+            return;
+        }
+    }
+    done(false);
+}
+
+bool RegisterBatcher::Register(const string& name, const string& stored) {
+    shared_ptr<promise<bool>> result = make_shared<promise<bool>>();
+    future<bool> ret = result->get_future();
+    Submit(name, stored, [result](bool ok) { result->set_value(ok); });
+    return ret.get();
+}
+
+void RegisterBatcher::Run_() {
+    vector<Item> batch;
+    unique_lock<mutex> locker(mtx_);
+    while(true) {
+        cond_.wait(locker, [this] { return closing_ || !queue_.empty(); });
+        if(queue_.empty()) { break; }
+        /* 自第一个注册到达起最多等windowMs，攒够maxRows_个立即写 */
+        chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(windowMs_);
+        cond_.wait_until(locker, deadline, [this] { return closing_ || queue_.size() >= maxRows_; });
+        size_t n = min(queue_.size(), maxRows_);
+        for(size_t i = 0; i < n; i++) {
+            batch.push_back(std::move(queue_.front()));
+            queue_.pop_front();
+        }
+        locker.unlock();
+        Flush_(batch);
+        batch.clear();
+        locker.lock();
+    }
+}
+
+void RegisterBatcher::Flush_(vector<Item>& batch) {
+    batches_.fetch_add(1, memory_order_relaxed);
+    rows_.fetch_add(batch.size(), memory_order_relaxed);
+    vector<char> result(batch.size(), 0);
+    UserCache* cache = UserCache::Instance();
+
+    /* 批内同名的只保留第一个，其余按用户名已被使用处理；缓存或Bloom过滤器认为不存在、且存储有唯一约束的不再查重 */
+    unordered_set<string> seen;
+    vector<size_t> rows;
+    vector<UserStore::NewUser> users;
+    for(size_t i = 0; i < batch.size(); i++) {
+        const string& name = batch[i].name;
+        if(name.empty() || !seen.insert(name).second) { continue; }
+        bool knownMissing = cache->SkipDuplicateCheck(name);
+        rows.push_back(i);
+        users.push_back({name, batch[i].stored, !knownMissing});
+    }
+    vector<char> ok;
+    UserStore::Instance()->Insert(users, ok);
+    for(size_t k = 0; k < rows.size(); k++) { result[rows[k]] = ok[k]; }
+
+    for(size_t i = 0; i < batch.size(); i++) {
+        if(result[i]) {
+            cache->Invalidate(batch[i].name);
+            cache->AddName(batch[i].name);
+        }
+        batch[i].done(result[i] != 0);
+    }
+    LOG_DEBUG("Register batch: %zu rows", batch.size());
+}
@@ -0,0 +1,62 @@
+#ifndef REGISTER_BATCHER_H
+#define REGISTER_BATCHER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+/*
+ * 注册的批量写入（group commit）
+ * 后台线程收集待注册的用户，攒够maxRows个或自第一个起等待windowMs后，整批交给UserStore::Insert一次写入
+ * （MySQL后端为一个连接、一个事务：一次 SELECT ... IN 查重，多行 INSERT 写入），每个请求单独拿到自己的结果
+ */
+class RegisterBatcher {
+public:
+    typedef std::function<void(bool)> Callback;
+
+    static RegisterBatcher* Instance();
+
+    void Init(int windowMs, int maxRows);   // windowMs<=0时关闭批量写入
+    void Close();                           // 写完已提交的注册后停止后台线程
+    bool Enabled() const { return running_.load(std::memory_order_acquire); }
+
+    /* 提交一个注册，stored为要保存的口令记录；写库后在后台线程上调用done */
+    void Submit(const std::string& name, const std::string& stored, Callback done);
+    bool Register(const std::string& name, const std::string& stored);  // 提交并阻塞等待结果（最长约batchMs加一次写库），不要在工作线程上调用
+
+    uint64_t Batches() const { return batches_.load(std::memory_order_relaxed); }
+    uint64_t Rows() const { return rows_.load(std::memory_order_relaxed); }
+
+private:
+    RegisterBatcher();
+    ~RegisterBatcher();
+
+    struct Item {
+        std::string name;
+        std::string stored;
+        Callback done;
+    };
+
+    void Run_();
+    void Flush_(std::vector<Item>& batch);
+
+    int windowMs_;
+    size_t maxRows_;
+    std::atomic<bool> running_;
+    bool closing_;                      // 由mtx_保护
+    std::deque<Item> queue_;
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    std::thread worker_;
+
+    std::atomic<uint64_t> batches_;     // 写库的批数
+    std::atomic<uint64_t> rows_;        // 批量写入的注册数
+};
+
+#endif //REGISTER_BATCHER_H
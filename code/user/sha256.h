@@ -0,0 +1,29 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/* SHA-256（FIPS 180-4），用于在内存中保存口令摘要而不是明文 */
+class Sha256 {
+public:
+    static const size_t DIGEST_SIZE = 32;
+
+    Sha256();
+    void Update(const void* data, size_t len);
+    void Final(uint8_t digest[DIGEST_SIZE]);    // 调用后对象需重新构造才能再用
+
+    static std::string Hash(const std::string& data);   // 返回32字节的二进制摘要
+    static std::string Hex(const std::string& digest);  // 二进制摘要转十六进制
+
+private:
+    void Transform_(const uint8_t block[64]);
+
+    uint32_t state_[8];
+    uint64_t bitLen_;
+    uint8_t block_[64];
+    size_t blockLen_;
+};
+
+#endif //SHA256_H
@@ -0,0 +1,105 @@
+#include "sqliteuserstore.h"
+#include <sqlite3.h>
+#include "../log/log.h"
+
+using namespace std;
+
+SqliteUserStore::SqliteUserStore() : db_(nullptr), select_(nullptr), insert_(nullptr) {}
+
+SqliteUserStore::~SqliteUserStore() {
+    sqlite3_finalize(select_);
+    sqlite3_finalize(insert_);
+    sqlite3_close(db_);
+}
+
+bool SqliteUserStore::Exec_(const char* sql) {
+    char* err = nullptr;
+    if(sqlite3_exec(db_, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        LOG_ERROR("Sqlite exec error: %s", err ? err : "");
+        sqlite3_free(err);
+        return false;
+    }
+    return true;
+}
+
+bool SqliteUserStore::Open(const string& path) {
+    /* 连接只在mtx_下使用，不需要SQLite自己的互斥 */
+    if(sqlite3_open_v2(path.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX,
+                       nullptr) != SQLITE_OK) {
+        return false;
+    }
+    if(!Exec_("PRAGMA journal_mode=WAL") || !Exec_("PRAGMA synchronous=NORMAL") ||
+       !Exec_("CREATE TABLE IF NOT EXISTS user(username TEXT PRIMARY KEY, password TEXT NOT NULL)")) {
+        return false;
+    }
+    return sqlite3_prepare_v2(db_, "SELECT password FROM user WHERE username=?", -1, &select_, nullptr) == SQLITE_OK &&
+           sqlite3_prepare_v2(db_, "INSERT INTO user(username, password) VALUES(?,?)", -1, &insert_, nullptr) == SQLITE_OK;
+}
+
+int SqliteUserStore::Fetch(const string& name, string& stored) {
+    lock_guard<mutex> locker(mtx_);
+    sqlite3_bind_text(select_, 1, name.data(), static_cast<int>(name.size()), SQLITE_STATIC);
+    int ret = sqlite3_step(select_);
+    int found = -1;
+    if(ret == SQLITE_ROW) {
+        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(select_, 0));
+        stored.assign(text ? text : "", sqlite3_column_bytes(select_, 0));
+        found = 1;
+    } else if(ret == SQLITE_DONE) {
+        found = 0;
+    } else {
+        LOG_ERROR("Sqlite select error: %s", sqlite3_errmsg(db_));
+    }
+    sqlite3_reset(select_);
+    sqlite3_clear_bindings(select_);
+    return found;
+}
+
+void SqliteUserStore::Insert(const vector<NewUser>& users, vector<char>& ok) {
+    ok.assign(users.size(), 0);
+    lock_guard<mutex> locker(mtx_);
+    /* 主键冲突只让该行失败，不影响同一事务内的其他行 */
+    bool txn = users.size() > 1 && Exec_("BEGIN");
+    for(size_t i = 0; i < users.size(); i++) {
+        sqlite3_bind_text(insert_, 1, users[i].name.data(), static_cast<int>(users[i].name.size()), SQLITE_STATIC);
+        sqlite3_bind_text(insert_, 2, users[i].stored.data(), static_cast<int>(users[i].stored.size()), SQLITE_STATIC);
+        int ret = sqlite3_step(insert_);
+        ok[i] = (ret == SQLITE_DONE);
+        if(ret != SQLITE_DONE && ret != SQLITE_CONSTRAINT) {
+            LOG_ERROR("Sqlite insert error: %s", sqlite3_errmsg(db_));
+        }
+        sqlite3_reset(insert_);
+        sqlite3_clear_bindings(insert_);
+    }
+    if(txn && !Exec_("COMMIT")) {
+        Exec_("ROLLBACK");
+        ok.assign(users.size(), 0);
+    }
+}
+
+long SqliteUserStore::Count() {
+    lock_guard<mutex> locker(mtx_);
+    sqlite3_stmt* stmt = nullptr;
+    long count = -1;
+    if(sqlite3_prepare_v2(db_, "SELECT COUNT(*) FROM user", -1, &stmt, nullptr) == SQLITE_OK &&
+       sqlite3_step(stmt) == SQLITE_ROW) {
+        count = static_cast<long>(sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+bool SqliteUserStore::ForEachName(const function<void(const string&)>& fn) {
+    lock_guard<mutex> locker(mtx_);
+    sqlite3_stmt* stmt = nullptr;
+    if(sqlite3_prepare_v2(db_, "SELECT username FROM user", -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    int ret;
+    while((ret = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        fn(string(text ? text : "", sqlite3_column_bytes(stmt, 0)));
+    }
+    sqlite3_finalize(stmt);
+    return ret == SQLITE_DONE;
+}
@@ -0,0 +1,36 @@
+#ifndef SQLITE_USER_STORE_H
+#define SQLITE_USER_STORE_H
+
+#include <mutex>
+#include "userstore.h"
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+/*
+ * 嵌入式SQLite后端：一个数据库文件、一个连接，各操作在互斥锁下串行执行（SQLite本身也只允许一个写者）
+ * 使用WAL日志、synchronous=NORMAL，一批注册在一个事务内写入，username为主键，重名由约束拒绝
+ */
+class SqliteUserStore : public UserStore {
+public:
+    SqliteUserStore();
+    ~SqliteUserStore();
+
+    bool Open(const std::string& path);     // 打开或创建数据库文件及user表
+
+    int Fetch(const std::string& name, std::string& stored) override;
+    void Insert(const std::vector<NewUser>& users, std::vector<char>& ok) override;
+    long Count() override;
+    bool ForEachName(const std::function<void(const std::string&)>& fn) override;
+    bool UniqueNames() override { return true; }   // username为主键
+
+private:
+    bool Exec_(const char* sql);
+
+    sqlite3* db_;
+    sqlite3_stmt* select_;
+    sqlite3_stmt* insert_;
+    std::mutex mtx_;
+};
+
+#endif //SQLITE_USER_STORE_H
@@ -0,0 +1,94 @@
+#include "passwordhash.h"
+#include "sha256.h"
+#include "../pool/sqlexecutor.h"
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <cassert>
+#include <chrono>
+
+// 测试PBKDF2-HMAC-SHA256标准向量（RFC 7914）
+void testPbkdf2() {
+    std::cout << "=== 测试PBKDF2 ===" << std::endl;
+    assert(Sha256::Hex(PasswordHash::Pbkdf2("passwd", "salt", 1, 64)) ==
+           "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc"
+           "49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783");
+    assert(Sha256::Hex(PasswordHash::Pbkdf2("Password", "NaCl", 80000, 64)) ==
+           "4ddcd8f60b98be21830cee5ef22701f9641a4418d04c0414aeff08876b34ab56"
+           "a1d425a1225833549adb841b51c9b3176a272bdebba1d078478f62b397f33c8d");
+    std::cout << "PBKDF2测试通过" << std::endl;
+}
+
+// 测试生成与验证口令记录
+void testHashVerify() {
+    std::cout << "\n=== 测试口令记录 ===" << std::endl;
+    PasswordHash::iterations = 0;
+    assert(PasswordHash::Hash("123") == "123");     // 关闭时保存明文
+    assert(PasswordHash::Verify("123", "123"));
+    assert(!PasswordHash::Verify("124", "123"));
+
+    PasswordHash::iterations = 1000;
+    std::string a = PasswordHash::Hash("123");
+    std::string b = PasswordHash::Hash("123");
+    std::cout << "记录: " << a << " (" << a.size() << "字节)" << std::endl;
+    assert(PasswordHash::IsHashed(a));
+    assert(a != b);                                 // 盐随机
+    assert(PasswordHash::Verify("123", a));
+    assert(PasswordHash::Verify("123", b));
+    assert(!PasswordHash::Verify("1234", a));
+    assert(!PasswordHash::Verify("", a));
+
+    PasswordHash::iterations = 2000;                // 调整次数后旧记录仍按记录中的次数验证
+    assert(PasswordHash::Verify("123", a));
+
+    assert(!PasswordHash::Verify("123", "pbkdf2_sha256$"));
+    assert(!PasswordHash::Verify("123", "pbkdf2_sha256$1000$zz$00"));
+    assert(!PasswordHash::Verify("123", "pbkdf2_sha256$0$00$00"));
+
+    PasswordHash::iterations = 100000;
+    auto start = std::chrono::steady_clock::now();
+    std::string slow = PasswordHash::Hash("123");
+    assert(PasswordHash::Verify("123", slow));
+    std::cout << "100000次迭代生成+验证耗时: " << std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count() << "ms" << std::endl;
+    std::cout << "口令记录测试通过" << std::endl;
+}
+
+// 测试哈希线程的并发与排队上限：超过上限的提交被拒绝
+void testBoundedExecutor() {
+    std::cout << "\n=== 测试哈希线程排队上限 ===" << std::endl;
+    PasswordHash::iterations = 20000;
+    SqlExecutor executor(2, 4);
+    std::atomic<int> running(0), maxRunning(0), finished(0);
+    int accepted = 0;
+    for(int i = 0; i < 10; i++) {
+        bool ok = executor.Submit([&running, &maxRunning]() {
+            int now = ++running;
+            int seen = maxRunning.load();
+            while(now > seen && !maxRunning.compare_exchange_weak(seen, now)) {}
+            bool result = PasswordHash::Verify("pwd", PasswordHash::Hash("pwd"));
+            --running;
+            return result;
+        }, [&finished](bool result) {
+            assert(result);
+            ++finished;
+        });
+        if(ok) { accepted++; }
+    }
+    assert(accepted == 4);
+    while(finished.load() < accepted) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    assert(maxRunning.load() <= 2);
+    assert(executor.Pending() == 0);
+    std::cout << "接受: " << accepted << "/10, 最大并发: " << maxRunning.load() << std::endl;
+    std::cout << "哈希线程排队上限测试通过" << std::endl;
+}
+
+int main() {
+    testPbkdf2();
+    testHashVerify();
+    testBoundedExecutor();
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "registerbatcher.h"
+#include "usercache.h"
+#include "../pool/sqlconnpool.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <string>
+#include <cassert>
+#include <chrono>
+
+// 每次运行用不同的用户名前缀，避免与之前写入的用户冲突
+static std::string prefix;
+
+static void WaitFor(std::atomic<int>& done, int n) {
+    while(done.load() < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// 测试并发注册被合并成少数几批，每个请求拿到自己的结果
+void testBatch() {
+    std::cout << "=== 测试批量注册 ===" << std::endl;
+    RegisterBatcher* batcher = RegisterBatcher::Instance();
+    uint64_t batches = batcher->Batches();
+    const int N = 40;
+    std::atomic<int> done(0), success(0);
+    std::vector<std::thread> threads;
+    for(int i = 0; i < N; i++) {
+        threads.emplace_back([i, batcher, &done, &success]() {
+            batcher->Submit(prefix + "u" + std::to_string(i), "pwd", [&done, &success](bool ok) {
+                if(ok) { ++success; }
+                ++done;
+            });
+        });
+    }
+    for(auto& th : threads) { th.join(); }
+    WaitFor(done, N);
+    uint64_t used = batcher->Batches() - batches;
+    std::cout << N << "个注册，" << used << "批，成功" << success.load() << std::endl;
+    assert(success.load() == N);
+    assert(used < static_cast<uint64_t>(N));
+    std::cout << "批量注册测试通过" << std::endl;
+}
+
+// 测试冲突：同一批内的同名注册只有一个成功，已存在的用户名注册失败
+void testConflict() {
+    std::cout << "\n=== 测试注册冲突 ===" << std::endl;
+    RegisterBatcher* batcher = RegisterBatcher::Instance();
+    std::atomic<int> done(0), success(0);
+    for(int i = 0; i < 3; i++) {
+        batcher->Submit(prefix + "dup", "pwd" + std::to_string(i), [&done, &success](bool ok) {
+            if(ok) { ++success; }
+            ++done;
+        });
+    }
+    WaitFor(done, 3);
+    assert(success.load() == 1);
+
+    assert(!batcher->Register(prefix + "dup", "other"));
+    assert(!batcher->Register(prefix + "u0", "other"));
+    assert(batcher->Register(prefix + "single", "pwd"));
+    assert(!batcher->Register("", "pwd"));
+    std::cout << "注册冲突测试通过" << std::endl;
+}
+
+// 测试关闭时写完已提交的注册，之后的提交直接失败
+void testClose() {
+    std::cout << "\n=== 测试关闭 ===" << std::endl;
+    RegisterBatcher* batcher = RegisterBatcher::Instance();
+    std::atomic<int> done(0), success(0);
+    for(int i = 0; i < 5; i++) {
+        batcher->Submit(prefix + "close" + std::to_string(i), "pwd", [&done, &success](bool ok) {
+            if(ok) { ++success; }
+            ++done;
+        });
+    }
+    batcher->Close();
+    assert(done.load() == 5 && success.load() == 5);
+    assert(!batcher->Enabled());
+    assert(!batcher->Register(prefix + "late", "pwd"));
+    std::cout << "关闭测试通过" << std::endl;
+}
+
+int main() {
+    // 初始化连接池（请根据实际数据库信息修改）
+    SqlConnPool::Instance()->Init("localhost", 3306, "nieqishuai", "1", "tinyweb", 2);
+    prefix = "batch" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count() % 1000000000) + "_";
+    RegisterBatcher::Instance()->Init(20, 16);
+
+    testBatch();
+    testConflict();
+    testClose();
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "usercache.h"
+#include "sha256.h"
+#include "userstore.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <chrono>
+
+// 测试SHA-256标准向量
+void testSha256() {
+    std::cout << "=== 测试SHA-256 ===" << std::endl;
+    assert(Sha256::Hex(Sha256::Hash("")) ==
+           "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    assert(Sha256::Hex(Sha256::Hash("abc")) ==
+           "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    assert(Sha256::Hex(Sha256::Hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")) ==
+           "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    // 跨多个块、分多次Update
+    Sha256 sha;
+    std::string a(1000, 'a');
+    for(int i = 0; i < 1000; i++) { sha.Update(a.data(), a.size()); }
+    uint8_t digest[Sha256::DIGEST_SIZE];
+    sha.Final(digest);
+    assert(Sha256::Hex(std::string(reinterpret_cast<char*>(digest), Sha256::DIGEST_SIZE)) ==
+           "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+    std::cout << "SHA-256测试通过" << std::endl;
+}
+
+// 测试命中、口令不一致、负缓存与注册冲突
+void testLookup() {
+    std::cout << "\n=== 测试缓存查询 ===" << std::endl;
+    UserCache* cache = UserCache::Instance();
+    bool ok = true;
+
+    assert(cache->Lookup("alice", "123") == UserCache::MISS);
+    assert(!cache->TryVerify("alice", "123", true, ok));       // 未缓存，需要查库
+
+    cache->PutUser("alice", "123");
+    assert(cache->Lookup("alice", "123") == UserCache::MATCH);
+    assert(cache->Lookup("alice", "456") == UserCache::MISMATCH);
+    assert(cache->TryVerify("alice", "123", true, ok) && ok);
+    assert(cache->TryVerify("alice", "456", true, ok) && !ok);
+    assert(cache->TryVerify("alice", "789", false, ok) && !ok);  // 用户名已被使用
+
+    cache->PutMissing("bob");
+    assert(cache->Lookup("bob", "x") == UserCache::NO_USER);
+    assert(cache->TryVerify("bob", "x", true, ok) && !ok);
+    assert(!cache->TryVerify("bob", "x", false, ok));           // 注册仍需写库
+
+    assert(cache->TryVerify("", "x", true, ok) && !ok);
+    assert(cache->TryVerify("carol", "", false, ok) && !ok);
+
+    cache->Invalidate("bob");
+    assert(cache->Lookup("bob", "x") == UserCache::MISS);
+    std::cout << "命中: " << cache->Hits() << ", 未命中: " << cache->Misses() << std::endl;
+    std::cout << "缓存查询测试通过" << std::endl;
+}
+
+// 测试过期
+void testExpire() {
+    std::cout << "\n=== 测试过期 ===" << std::endl;
+    UserCache* cache = UserCache::Instance();
+    cache->PutUser("dave", "pwd");
+    cache->PutMissing("erin");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    assert(cache->Lookup("dave", "pwd") == UserCache::MISS);
+    assert(cache->Lookup("erin", "pwd") == UserCache::MISS);
+    std::cout << "过期测试通过" << std::endl;
+}
+
+// 测试多线程并发读写
+void testConcurrent() {
+    std::cout << "\n=== 测试并发访问 ===" << std::endl;
+    UserCache* cache = UserCache::Instance();
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 8; t++) {
+        threads.emplace_back([cache, t]() {
+            for(int i = 0; i < 2000; i++) {
+                std::string name = "user" + std::to_string((t * 131 + i) % 500);
+                bool ok;
+                if(!cache->TryVerify(name, name, true, ok)) { cache->PutUser(name, name); }
+                else { assert(ok); }
+            }
+        });
+    }
+    for(auto& th : threads) { th.join(); }
+    std::cout << "并发访问测试通过" << std::endl;
+}
+
+// 测试Bloom过滤器：加载前不做判断，加载后未加入的名字绝大多数被判定为不存在；
+// 登录不因它判定失败，有唯一约束的存储注册时省去查重
+void testBloom() {
+    std::cout << "\n=== 测试Bloom过滤器 ===" << std::endl;
+    UserCache* cache = UserCache::Instance();
+    assert(cache->MayExist("nobody"));
+    std::vector<char> inserted;
+    UserStore::Instance()->Insert({{"stored1", "x", true}, {"stored2", "x", true}}, inserted);
+    assert(cache->LoadNames(UserStore::Instance()));
+    assert(cache->MayExist("stored1") && cache->MayExist("stored2"));
+    for(int i = 0; i < 1000; i++) { cache->AddName("bloom" + std::to_string(i)); }
+    for(int i = 0; i < 1000; i++) { assert(cache->MayExist("bloom" + std::to_string(i))); }
+    int falsePositive = 0;
+    for(int i = 0; i < 10000; i++) {
+        if(cache->MayExist("absent" + std::to_string(i))) { falsePositive++; }
+    }
+    std::cout << "误判: " << falsePositive << "/10000" << std::endl;
+    assert(falsePositive < 100);
+
+    bool ok = true;
+    assert(!cache->MayExist("absent-user"));
+    assert(!cache->TryVerify("absent-user", "x", true, ok));
+    uint64_t skips = cache->BloomSkips();
+    assert(cache->SkipDuplicateCheck("absent-user"));
+    assert(!cache->SkipDuplicateCheck("stored1"));
+    assert(cache->BloomSkips() == skips + 1);
+    std::cout << "Bloom过滤器测试通过" << std::endl;
+}
+
+int main() {
+    // 使用内存后端，不依赖数据库
+    UserStore::Init("memory", "");
+    UserCache::Instance()->Init(1);
+
+    testSha256();
+    testLookup();
+    testExpire();
+    testConcurrent();
+    testBloom();
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "userstore.h"
+#include "memoryuserstore.h"
+#include "sqliteuserstore.h"
+#include "mysqluserstore.h"
+#include "../pool/sqlconnpool.h"
+#include <unistd.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <string>
+#include <cassert>
+#include <chrono>
+
+// 每次运行用不同的用户名前缀，避免与之前写入的用户冲突
+static std::string prefix;
+
+// 测试查询与写入：新用户写入后可查到，重名写入失败，不影响同批的其他用户
+void testFetchInsert(UserStore* store) {
+    std::string stored;
+    assert(store->Fetch(prefix + "a", stored) == 0);
+    long before = store->Count();
+    assert(before >= 0);
+
+    std::vector<char> ok;
+    store->Insert({{prefix + "a", "pa", true}}, ok);
+    assert(ok.size() == 1 && ok[0]);
+    assert(store->Fetch(prefix + "a", stored) == 1 && stored == "pa");
+
+    store->Insert({{prefix + "b", "pb", true}, {prefix + "a", "other", true}, {prefix + "c", "pc", false}}, ok);
+    assert(ok.size() == 3 && ok[0] && !ok[1] && ok[2]);
+    assert(store->Fetch(prefix + "a", stored) == 1 && stored == "pa");
+    assert(store->Fetch(prefix + "c", stored) == 1 && stored == "pc");
+    assert(store->Count() == before + 3);
+
+    int found = 0;
+    assert(store->ForEachName([&found](const std::string& name) {
+        if(name.compare(0, prefix.size(), prefix) == 0) { found++; }
+    }));
+    assert(found == 3);
+}
+
+// 测试并发：多个线程同时注册不同的用户，全部成功且都能查到
+void testConcurrent(UserStore* store) {
+    const int THREADS = 8, PER_THREAD = 50;
+    std::atomic<int> success(0);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < THREADS; t++) {
+        threads.emplace_back([t, store, &success]() {
+            std::vector<char> ok;
+            for(int i = 0; i < PER_THREAD; i++) {
+                std::string name = prefix + "t" + std::to_string(t) + "_" + std::to_string(i);
+                store->Insert({{name, "pwd", true}}, ok);
+                std::string stored;
+                if(ok[0] && store->Fetch(name, stored) == 1 && stored == "pwd") { ++success; }
+            }
+        });
+    }
+    for(auto& th : threads) { th.join(); }
+    assert(success.load() == THREADS * PER_THREAD);
+}
+
+void testStore(const char* type, UserStore* store) {
+    std::cout << "=== 测试" << type << "后端 ===" << std::endl;
+    testFetchInsert(store);
+    testConcurrent(store);
+    std::cout << type << "后端测试通过\n" << std::endl;
+}
+
+int main() {
+    prefix = "store" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count() % 1000000000) + "_";
+
+    MemoryUserStore memory;
+    testStore("memory", &memory);
+
+    std::string path = "/tmp/testuserstore_" + std::to_string(getpid()) + ".db";
+    {
+        SqliteUserStore sqlite;
+        assert(sqlite.Open(path));
+        testStore("sqlite", &sqlite);
+    }
+    unlink(path.c_str());
+    unlink((path + "-wal").c_str());
+    unlink((path + "-shm").c_str());
+
+    // 初始化连接池（请根据实际数据库信息修改），连不上数据库时跳过MySQL后端
+    SqlConnPool::Instance()->Init("localhost", 3306, "nieqishuai", "1", "tinyweb", 2);
+    MysqlUserStore mysql;
+    if(mysql.Count() < 0) {
+        std::cout << "无法连接数据库，跳过mysql后端" << std::endl;
+    } else {
+        testStore("mysql", &mysql);
+    }
+
+    assert(!UserStore::Init("unknown", ""));
+    assert(UserStore::Init("memory", "") && UserStore::Type() == "memory");
+    return 0;
+}
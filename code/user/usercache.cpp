@@ -0,0 +1,209 @@
+#include "usercache.h"
+#include <random>
+#include <algorithm>
+#include "sha256.h"
+#include "userstore.h"
+#include "../log/log.h"
+
+using namespace std;
+
+const int UserCache::SHARD_NUM;
+const size_t UserCache::SHARD_CAPACITY;
+const int UserCache::NEGATIVE_TTL_S;
+const int UserCache::BLOOM_HASHES;
+const size_t UserCache::BLOOM_MIN_BITS;
+
+UserCache::UserCache() : ttlSec_(0), bits_(nullptr), bitNum_(0), bloomReady_(false),
+    hits_(0), misses_(0), bloomSkips_(0) {}
+
+UserCache* UserCache::Instance() {
+    static UserCache cache;
+    return &cache;
+}
+
+void UserCache::Init(int ttlSec) {
+    ttlSec_ = ttlSec;
+    /* 每个进程一份随机盐，内存中的摘要无法用预先算好的口令表反查 */
+    random_device rd;
+    salt_.clear();
+    for(int i = 0; i < 4; i++) {
+        uint32_t r = rd();
+        salt_.append(reinterpret_cast<const char*>(&r), sizeof(r));
+    }
+}
+
+UserCache::Shard& UserCache::ShardOf_(const string& name) {
+    return shards_[Fnv1a_(name) % SHARD_NUM];
+}
+
+uint64_t UserCache::Fnv1a_(const string& s) {
+    uint64_t h = 1469598103934665603ULL;
+    for(unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+string UserCache::Digest_(const string& pwd) const {
+    return Sha256::Hash(salt_ + pwd);
+}
+
+/* 比较耗时与第一个不同字节的位置无关 */
+static bool DigestEqual(const string& a, const string& b) {
+    if(a.size() != b.size()) { return false; }
+    unsigned char diff = 0;
+    for(size_t i = 0; i < a.size(); i++) {
+        diff |= static_cast<unsigned char>(a[i] ^ b[i]);
+    }
+    return diff == 0;
+}
+
+UserCache::RESULT UserCache::Lookup(const string& name, const string& pwd) {
+    if(!Enabled()) { return MISS; }
+    Entry entry;
+    {
+        Shard& shard = ShardOf_(name);
+        lock_guard<mutex> locker(shard.mtx);
+        auto it = shard.map.find(name);
+        if(it == shard.map.end()) { return MISS; }
+        if(it->second.expire <= Clock::now()) {
+            shard.map.erase(it);
+            return MISS;
+        }
+        entry = it->second;
+    }
+    if(!entry.exists) { return NO_USER; }
+    /* 摘要在锁外计算 */
+    return DigestEqual(entry.digest, Digest_(pwd)) ? MATCH : MISMATCH;
+}
+
+bool UserCache::TryVerify(const string& name, const string& pwd, bool isLogin, bool& ok) {
+    if(!Enabled()) { return false; }
+    if(name.empty() || pwd.empty()) {
+        ok = false;
+        return true;
+    }
+    RESULT result = Lookup(name, pwd);
+    (result == MISS ? misses_ : hits_).fetch_add(1, memory_order_relaxed);
+    if(isLogin) {
+        /* Bloom过滤器看不到其他实例注册的用户，未命中时交给查库 */
+        if(result != MISS) {
+            ok = (result == MATCH);
+            return true;
+        }
+        return false;
+    }
+    if(result == MATCH || result == MISMATCH) {
+        /* 用户名已被使用，注册失败 */
+        ok = false;
+        return true;
+    }
+    return false;
+}
+
+void UserCache::Put_(const string& name, Entry&& entry) {
+    Shard& shard = ShardOf_(name);
+    lock_guard<mutex> locker(shard.mtx);
+    if(shard.map.size() >= SHARD_CAPACITY && shard.map.find(name) == shard.map.end()) {
+        /* 分片已满：先清掉过期的，仍然满就随便淘汰一个 */
+        Clock::time_point now = Clock::now();
+        for(auto it = shard.map.begin(); it != shard.map.end(); ) {
+            if(it->second.expire <= now) { it = shard.map.erase(it); }
+            else { ++it; }
+        }
+        if(shard.map.size() >= SHARD_CAPACITY) {
+            shard.map.erase(shard.map.begin());
+        }
+    }
+    shard.map[name] = std::move(entry);
+}
+
+void UserCache::PutUser(const string& name, const string& pwd) {
+    if(!Enabled()) { return; }
+    Entry entry;
+    entry.exists = true;
+    entry.digest = Digest_(pwd);
+    entry.expire = Clock::now() + chrono::seconds(ttlSec_);
+    Put_(name, std::move(entry));
+}
+
+void UserCache::PutMissing(const string& name) {
+    if(!Enabled()) { return; }
+    Entry entry;
+    entry.exists = false;
+    entry.expire = Clock::now() + chrono::seconds(min(ttlSec_, NEGATIVE_TTL_S));
+    Put_(name, std::move(entry));
+}
+
+void UserCache::Invalidate(const string& name) {
+    if(!Enabled()) { return; }
+    Shard& shard = ShardOf_(name);
+    lock_guard<mutex> locker(shard.mtx);
+    shard.map.erase(name);
+}
+
+bool UserCache::MayExist(const string& name) const {
+    size_t bitNum = bitNum_.load(memory_order_acquire);
+    if(bitNum == 0 || !bloomReady_.load(memory_order_acquire)) { return true; }
+    /* 双重散列：第i个位置为 h1 + i*h2 */
+    uint64_t h1 = Fnv1a_(name);
+    uint64_t h2 = (h1 >> 33 | h1 << 31) * 0x9e3779b97f4a7c15ULL | 1;
+    for(int i = 0; i < BLOOM_HASHES; i++) {
+        uint64_t bit = (h1 + i * h2) % bitNum;
+        if(!(bits_[bit / 64].load(memory_order_relaxed) & (1ULL << (bit % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool UserCache::SkipDuplicateCheck(const string& name) {
+    if(!Enabled() || !UserStore::Instance()->UniqueNames()) { return false; }
+    if(Lookup(name, string()) != NO_USER && MayExist(name)) { return false; }
+    bloomSkips_.fetch_add(1, memory_order_relaxed);
+    return true;
+}
+
+void UserCache::AddName(const string& name) {
+    size_t bitNum = bitNum_.load(memory_order_acquire);
+    if(bitNum == 0) { return; }
+    uint64_t h1 = Fnv1a_(name);
+    uint64_t h2 = (h1 >> 33 | h1 << 31) * 0x9e3779b97f4a7c15ULL | 1;
+    for(int i = 0; i < BLOOM_HASHES; i++) {
+        uint64_t bit = (h1 + i * h2) % bitNum;
+        bits_[bit / 64].fetch_or(1ULL << (bit % 64), memory_order_relaxed);
+    }
+}
+
+bool UserCache::LoadNames(UserStore* store) {
+    if(!Enabled() || bitNum_.load() != 0) { return false; }
+    long users = store->Count();
+    if(users < 0) {
+        LOG_WARN("UserCache: user store unavailable, bloom filter disabled");
+        return false;
+    }
+    /* 按现有用户数的两倍（留出增长空间）、每个名字10比特确定位数 */
+    size_t bitNum = max(BLOOM_MIN_BITS, static_cast<size_t>(users) * 2 * 10);
+    bitNum = (bitNum + 63) / 64 * 64;
+    bitsOwner_.reset(new std::atomic<uint64_t>[bitNum / 64]);
+    for(size_t i = 0; i < bitNum / 64; i++) {
+        bitsOwner_[i].store(0, memory_order_relaxed);
+    }
+    bits_ = bitsOwner_.get();
+    /* 先发布位数组再扫描：扫描期间注册的用户由AddName写入，不会漏掉 */
+    bitNum_.store(bitNum, memory_order_release);
+
+    size_t loaded = 0;
+    bool ok = store->ForEachName([this, &loaded](const string& name) {
+        AddName(name);
+        loaded++;
+    });
+    if(!ok) {
+        LOG_WARN("UserCache: load user names failed, bloom filter disabled");
+        return false;
+    }
+    bloomReady_.store(true, memory_order_release);
+    LOG_INFO("UserCache: bloom filter loaded %zu names, %zu bits", loaded, bitNum);
+    return true;
+}
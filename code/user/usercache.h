@@ -0,0 +1,97 @@
+#ifndef USER_CACHE_H
+#define USER_CACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+
+class UserStore;
+
+/*
+ * 登录/注册验证结果缓存
+ * 按用户名分片缓存用户记录：存在的用户保存“进程随机盐+口令”的SHA-256摘要（不保存明文），
+ * 不存在的用户做负缓存（有效期更短）；另有一个用户名的Bloom过滤器，启动时从用户存储加载，
+ * 对“一定不存在”的用户名，注册省去查重的SELECT
+ * Bloom过滤器只随本进程的注册增加，看不到其他实例或直接写库新增的用户，因此：
+ * 登录不依据它判定失败，仍去查库；注册只在存储对用户名有唯一约束时才省去查重，漏判的同名写入由约束拒绝
+ */
+class UserCache {
+public:
+    enum RESULT {
+        MISS = 0,       ///< 未缓存或已过期
+        NO_USER,        ///< 用户不存在（负缓存）
+        MATCH,          ///< 用户存在且口令一致
+        MISMATCH,       ///< 用户存在但口令不一致
+    };
+
+    static UserCache* Instance();
+
+    void Init(int ttlSec);                  // ttlSec<=0时关闭缓存与Bloom过滤器
+    bool Enabled() const { return ttlSec_ > 0; }
+
+    /* 只用缓存回答一次验证，能确定结果时返回true并写入ok，否则需要查库 */
+    bool TryVerify(const std::string& name, const std::string& pwd, bool isLogin, bool& ok);
+
+    RESULT Lookup(const std::string& name, const std::string& pwd);
+    void PutUser(const std::string& name, const std::string& pwd);  // 记录查库得到的用户及其口令
+    void PutMissing(const std::string& name);                       // 记录查库确认不存在的用户
+    void Invalidate(const std::string& name);                       // 注册成功后清除该用户的缓存
+
+    bool LoadNames(UserStore* store);        // 从用户存储加载全部用户名到Bloom过滤器，完成前MayExist恒为true
+    bool MayExist(const std::string& name) const;   // false表示本进程所知的用户中一定没有
+    /* 注册时能否省去查重：负缓存或Bloom过滤器认为不存在，且存储有唯一约束兜底 */
+    bool SkipDuplicateCheck(const std::string& name);
+    void AddName(const std::string& name);
+
+    uint64_t Hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t Misses() const { return misses_.load(std::memory_order_relaxed); }
+    uint64_t BloomSkips() const { return bloomSkips_.load(std::memory_order_relaxed); }
+
+private:
+    UserCache();
+    ~UserCache() = default;
+
+    typedef std::chrono::steady_clock Clock;
+
+    static const int SHARD_NUM = 16;
+    static const size_t SHARD_CAPACITY = 8192;  // 每个分片的条目上限，防止大量随机用户名撑爆负缓存
+    static const int NEGATIVE_TTL_S = 10;       // 负缓存有效期上限
+    static const int BLOOM_HASHES = 7;          // 每个用户名置位数，每个名字10比特时误判率约1%
+    static const size_t BLOOM_MIN_BITS = 1 << 20;
+
+    struct Entry {
+        bool exists;
+        std::string digest;         // exists时为 SHA-256(salt_ + 口令)
+        Clock::time_point expire;
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, Entry> map;
+    };
+
+    Shard& ShardOf_(const std::string& name);
+    void Put_(const std::string& name, Entry&& entry);
+    std::string Digest_(const std::string& pwd) const;
+    static uint64_t Fnv1a_(const std::string& s);
+
+    int ttlSec_;
+    std::string salt_;
+    Shard shards_[SHARD_NUM];
+
+    /* 位数组分配后先发布bits_再发布bitNum_，读者看到bitNum_非0即可访问；分配后不再释放 */
+    std::unique_ptr<std::atomic<uint64_t>[]> bitsOwner_;
+    std::atomic<uint64_t>* bits_;
+    std::atomic<size_t> bitNum_;
+    std::atomic<bool> bloomReady_;      // 加载完成后Bloom过滤器的否定结果才可信
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> bloomSkips_;      // 注册时省去的查重次数
+};
+
+#endif //USER_CACHE_H
@@ -0,0 +1,33 @@
+#include "userstore.h"
+#include "mysqluserstore.h"
+#include "sqliteuserstore.h"
+#include "memoryuserstore.h"
+
+using namespace std;
+
+unique_ptr<UserStore> UserStore::store_(new MysqlUserStore());
+string UserStore::type_ = "mysql";
+
+UserStore* UserStore::Instance() {
+    return store_.get();
+}
+
+bool UserStore::Init(const string& type, const string& path) {
+    if(type.empty() || type == "mysql") {
+        store_.reset(new MysqlUserStore());
+    } else if(type == "sqlite") {
+        unique_ptr<SqliteUserStore> store(new SqliteUserStore());
+        if(!store->Open(path)) { return false; }
+        store_ = std::move(store);
+    } else if(type == "memory") {
+        store_.reset(new MemoryUserStore());
+    } else {
+        return false;
+    }
+    type_ = type.empty() ? "mysql" : type;
+    return true;
+}
+
+const string& UserStore::Type() {
+    return type_;
+}
@@ -0,0 +1,45 @@
+#ifndef USER_STORE_H
+#define USER_STORE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+/*
+ * 用户数据的存储后端，登录/注册、注册批量写入和Bloom过滤器的加载都经由它访问用户表
+ * 在config.txt中用userStore选择：mysql（默认，经SqlConnPool）、sqlite（嵌入式数据库文件）、
+ * memory（分段加锁的内存哈希表，进程退出即丢失），后两者不需要MySQL即可压测完整的请求路径
+ * 实现需能被多个线程同时调用
+ */
+class UserStore {
+public:
+    struct NewUser {
+        std::string name;
+        std::string stored;     // 要保存的口令记录
+        bool check;             // 是否需要查重，为false时由唯一约束拒绝同名写入（见UniqueNames）
+    };
+
+    virtual ~UserStore() {}
+
+    /* 取用户的口令记录：返回1存在，0不存在，-1出错；记录超长等无法取出时返回1且stored为空 */
+    virtual int Fetch(const std::string& name, std::string& stored) = 0;
+    /* 写入一批用户名互不相同的新用户，ok[i]为第i个是否写入（用户名已被使用或出错时为0） */
+    virtual void Insert(const std::vector<NewUser>& users, std::vector<char>& ok) = 0;
+    virtual long Count() = 0;           // 用户数，出错返回-1
+    virtual bool ForEachName(const std::function<void(const std::string&)>& fn) = 0;  // 依次回调全部用户名
+    /* 存储是否以唯一约束保证用户名不重复：是则同名写入必然失败，注册可以不查重 */
+    virtual bool UniqueNames() { return false; }
+
+    static UserStore* Instance();       // 当前使用的后端，Init之前为MySQL
+    /* 按名字选择后端：mysql、sqlite、memory；path为SQLite的数据库文件，表不存在时创建；失败返回false
+       需在其他线程访问用户数据之前调用 */
+    static bool Init(const std::string& type, const std::string& path);
+    static const std::string& Type();
+
+private:
+    static std::unique_ptr<UserStore> store_;
+    static std::string type_;
+};
+
+#endif //USER_STORE_H
@@ -0,0 +1,687 @@
+/*
+ * loadgen - 基于epoll的HTTP压测工具
+ *
+ * 与webbench相比：
+ *   - 长连接复用，支持流水线深度(pipelining)
+ *   - 闭环模式(尽力压满)与开环定速模式；开环模式按计划发送时间计算延迟，
+ *     避免协调遗漏(coordinated omission)导致的延迟低估
+ *   - 支持多URL混合、resources目录扫描、登录/注册POST流程
+ *   - 输出 p50/p90/p99/p99.9 延迟，可选JSON结果用于回归对比
+ *
+ * 用法: loadgen --help
+ */
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <time.h>
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include "../code/metrics/metrics.h"
+
+using namespace std;
+
+/* 单调时钟，纳秒 */
+static uint64_t NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+/* 一种请求模板，按权重混合发送 */
+struct RequestTemplate {
+    string method;
+    string path;
+    string body;            // POST表单
+    bool uniqueUser;        // 注册请求：每次生成不重复的用户名
+    string userPrefix;
+    string password;
+};
+
+struct Options {
+    string host = "127.0.0.1";
+    int port = 1316;
+    int connections = 10;
+    int threads = 1;
+    int duration = 10;          // 秒
+    int pipeline = 1;           // 每个连接最多同时在途的请求数
+    double rate = 0;            // 总请求速率(req/s)，0表示闭环
+    bool keepAlive = true;
+    string jsonFile;            // "-" 表示输出到标准输出
+    vector<RequestTemplate> requests;
+};
+
+/* 单个工作线程的统计结果 */
+struct Stats {
+    uint64_t completed = 0;
+    uint64_t status2xx = 0;
+    uint64_t status3xx = 0;
+    uint64_t status4xx = 0;
+    uint64_t status5xx = 0;
+    uint64_t connectErrors = 0;
+    uint64_t readErrors = 0;
+    uint64_t writeErrors = 0;
+    uint64_t dropped = 0;           // 连接断开时还没有收到响应的请求
+    uint64_t reconnects = 0;
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t maxLatencyUs = 0;
+    Histogram latency;
+};
+
+struct Conn {
+    int fd = -1;
+    bool connecting = false;
+    bool closeAfter = false;        // 服务器声明 Connection: close
+    string out;                     // 待发送数据
+    size_t outOff = 0;
+    string in;                      // 已接收未解析的数据
+    size_t inOff = 0;
+    deque<uint64_t> pending;        // 在途请求的起始时间(开环模式为计划发送时间)
+    uint64_t nextSend = 0;          // 开环模式下一个请求的计划发送时间
+    uint64_t retryAt = 0;           // 出错断开后，到该时间才重新连接
+    int backoffMs = 0;              // 当前重连退避时长，收到响应后清零
+};
+
+static const int RECONNECT_MIN_MS = 1;      // 出错断开后的首次重连延迟
+static const int RECONNECT_MAX_MS = 100;    // 连续出错时延迟加倍，最多到该值
+
+static atomic<bool> g_stop(false);
+static atomic<uint64_t> g_userSeq(0);
+
+static void OnSignal(int) {
+    g_stop = true;
+}
+
+class Worker {
+public:
+    Worker(const Options& opt, const sockaddr_in& addr, int conns, double rate, int id)
+        : opt_(opt), addr_(addr), conns_(conns), rate_(rate), id_(id), tplSeq_(id) {}
+
+    void Run(uint64_t endNs);
+    const Stats& GetStats() const { return stats_; }
+
+private:
+    bool Connect_(Conn& c);
+    void Close_(Conn& c, bool reconnect);
+    void Backoff_(Conn& c);
+    void Fill_(Conn& c, uint64_t now);
+    void AppendRequest_(Conn& c);
+    bool Flush_(Conn& c);
+    bool Read_(Conn& c);
+    bool Parse_(Conn& c);
+    void UpdateEvents_(Conn& c);
+    void Record_(uint64_t startNs, int code);
+
+    const Options& opt_;
+    sockaddr_in addr_;
+    int conns_;
+    double rate_;
+    int id_;
+    uint64_t tplSeq_;
+    uint64_t intervalNs_ = 0;
+    int epollFd_ = -1;
+    vector<Conn> pool_;
+    Stats stats_;
+};
+
+bool Worker::Connect_(Conn& c) {
+    c.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(c.fd < 0) {
+        stats_.connectErrors++;
+        Backoff_(c);
+        return false;
+    }
+    int one = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    int ret = connect(c.fd, reinterpret_cast<const sockaddr*>(&addr_), sizeof(addr_));
+    if(ret < 0 && errno != EINPROGRESS) {
+        stats_.connectErrors++;
+        Backoff_(c);
+        close(c.fd);
+        c.fd = -1;
+        return false;
+    }
+    c.connecting = (ret < 0);
+    c.closeAfter = false;
+    c.out.clear();
+    c.outOff = 0;
+    c.in.clear();
+    c.inOff = 0;
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+    ev.data.ptr = &c;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, c.fd, &ev);
+    return true;
+}
+
+void Worker::Close_(Conn& c, bool reconnect) {
+    if(c.fd >= 0) {
+        epoll_ctl(epollFd_, EPOLL_CTL_DEL, c.fd, nullptr);
+        close(c.fd);
+        c.fd = -1;
+    }
+    /* 未完成的请求计为错误：开环模式保留计划时间重新发送，闭环模式直接丢弃。
+       有请求丢失说明连接异常断开，稍等再重连，避免对出错的服务器空转重连 */
+    bool lost = !c.pending.empty();
+    stats_.dropped += c.pending.size();
+    if(rate_ > 0 && lost) {
+        c.nextSend = min(c.nextSend, c.pending.front());
+    }
+    c.pending.clear();
+    if(reconnect && !g_stop) {
+        stats_.reconnects++;
+        if(lost) {
+            Backoff_(c);
+        } else {
+            Connect_(c);
+        }
+    }
+}
+
+void Worker::Backoff_(Conn& c) {
+    c.backoffMs = c.backoffMs ? min(c.backoffMs * 2, RECONNECT_MAX_MS) : RECONNECT_MIN_MS;
+    c.retryAt = NowNs() + static_cast<uint64_t>(c.backoffMs) * 1000000ULL;
+}
+
+void Worker::AppendRequest_(Conn& c) {
+    const RequestTemplate& tpl = opt_.requests[tplSeq_++ % opt_.requests.size()];
+    string body = tpl.body;
+    if(tpl.uniqueUser) {
+        char user[128];
+        snprintf(user, sizeof(user), "%s%d_%llu", tpl.userPrefix.c_str(), id_,
+                 static_cast<unsigned long long>(g_userSeq++));
+        body = string("username=") + user + "&password=" + tpl.password;
+    }
+    string& out = c.out;
+    out += tpl.method + " " + tpl.path + " HTTP/1.1\r\nHost: " + opt_.host + "\r\n";
+    out += opt_.keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    if(tpl.method == "POST") {
+        out += "Content-Type: application/x-www-form-urlencoded\r\n";
+        out += "Content-Length: " + to_string(body.size()) + "\r\n\r\n" + body;
+    } else {
+        out += "\r\n";
+    }
+}
+
+void Worker::Fill_(Conn& c, uint64_t now) {
+    if(c.fd < 0 || c.connecting || c.closeAfter) {
+        return;
+    }
+    size_t depth = opt_.keepAlive ? static_cast<size_t>(opt_.pipeline) : 1;
+    while(c.pending.size() < depth) {
+        uint64_t start = now;
+        if(rate_ > 0) {
+            if(c.nextSend > now) { break; }
+            /* 开环：延迟从计划发送时间算起，积压的请求同样计入等待时间 */
+            start = c.nextSend;
+            c.nextSend += intervalNs_;
+        }
+        AppendRequest_(c);
+        c.pending.push_back(start);
+    }
+}
+
+bool Worker::Flush_(Conn& c) {
+    while(c.outOff < c.out.size()) {
+        ssize_t n = send(c.fd, c.out.data() + c.outOff, c.out.size() - c.outOff, MSG_NOSIGNAL);
+        if(n < 0) {
+            if(errno == EAGAIN || errno == EWOULDBLOCK) { break; }
+            stats_.writeErrors++;
+            return false;
+        }
+        c.outOff += n;
+        stats_.bytesOut += n;
+    }
+    if(c.outOff == c.out.size()) {
+        c.out.clear();
+        c.outOff = 0;
+    }
+    return true;
+}
+
+bool Worker::Read_(Conn& c) {
+    char buf[65536];
+    while(true) {
+        ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+        if(n > 0) {
+            c.in.append(buf, n);
+            stats_.bytesIn += n;
+            continue;
+        }
+        if(n == 0) {
+            return false;
+        }
+        if(errno == EAGAIN || errno == EWOULDBLOCK) {
+            return true;
+        }
+        stats_.readErrors++;
+        return false;
+    }
+}
+
+/* 解析已接收的完整响应，返回false表示连接需要关闭 */
+bool Worker::Parse_(Conn& c) {
+    while(!c.pending.empty()) {
+        size_t headEnd = c.in.find("\r\n\r\n", c.inOff);
+        if(headEnd == string::npos) { break; }
+        const char* head = c.in.data() + c.inOff;
+        size_t headLen = headEnd - c.inOff;
+
+        int code = 0;
+        if(headLen > 12 && strncmp(head, "HTTP/1.", 7) == 0) {
+            code = atoi(head + 9);
+        }
+        size_t bodyLen = 0;
+        bool closeConn = false;
+        size_t pos = c.inOff;
+        while(pos < headEnd) {
+            size_t eol = c.in.find("\r\n", pos);
+            const char* line = c.in.data() + pos;
+            size_t lineLen = eol - pos;
+            if(lineLen > 15 && strncasecmp(line, "Content-length:", 15) == 0) {
+                bodyLen = strtoul(line + 15, nullptr, 10);
+            } else if(lineLen >= 17 && strncasecmp(line, "Connection: close", 17) == 0) {
+                closeConn = true;
+            }
+            pos = eol + 2;
+        }
+        size_t total = headLen + 4 + bodyLen;
+        if(c.in.size() - c.inOff < total) { break; }
+
+        c.inOff += total;
+        Record_(c.pending.front(), code);
+        c.pending.pop_front();
+        c.backoffMs = 0;
+        if(closeConn) {
+            c.closeAfter = true;
+            return false;
+        }
+    }
+    if(c.inOff > 0 && (c.inOff == c.in.size() || c.inOff > 65536)) {
+        c.in.erase(0, c.inOff);
+        c.inOff = 0;
+    }
+    return true;
+}
+
+void Worker::Record_(uint64_t startNs, int code) {
+    uint64_t us = (NowNs() - startNs) / 1000;
+    stats_.latency.Record(us);
+    stats_.maxLatencyUs = max(stats_.maxLatencyUs, us);
+    stats_.completed++;
+    if(code >= 200 && code < 300) stats_.status2xx++;
+    else if(code >= 300 && code < 400) stats_.status3xx++;
+    else if(code >= 400 && code < 500) stats_.status4xx++;
+    else stats_.status5xx++;
+}
+
+void Worker::UpdateEvents_(Conn& c) {
+    if(c.fd < 0) { return; }
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    if(c.connecting || !c.out.empty()) {
+        ev.events |= EPOLLOUT;
+    }
+    ev.data.ptr = &c;
+    epoll_ctl(epollFd_, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+void Worker::Run(uint64_t endNs) {
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    pool_.resize(conns_);
+    uint64_t now = NowNs();
+    if(rate_ > 0) {
+        /* 每个连接均分速率，并错开起始时间 */
+        intervalNs_ = static_cast<uint64_t>(1e9 * conns_ / rate_);
+        for(int i = 0; i < conns_; i++) {
+            pool_[i].nextSend = now + intervalNs_ * i / conns_;
+        }
+    }
+    for(auto& c : pool_) {
+        Connect_(c);
+    }
+
+    vector<epoll_event> events(1024);
+    while(!g_stop && (now = NowNs()) < endNs) {
+        bool waiting = false;
+        for(auto& c : pool_) {
+            if(c.fd < 0) {
+                if(now >= c.retryAt) {
+                    Connect_(c);
+                }
+                waiting = waiting || c.fd < 0;
+                continue;
+            }
+            size_t before = c.pending.size();
+            Fill_(c, now);
+            if(c.pending.size() != before) {
+                if(!Flush_(c)) {
+                    Close_(c, true);
+                    continue;
+                }
+                UpdateEvents_(c);
+            }
+        }
+
+        int timeoutMs = 100;
+        if(rate_ > 0 || waiting) {
+            timeoutMs = 1;
+        }
+        int n = epoll_wait(epollFd_, events.data(), static_cast<int>(events.size()), timeoutMs);
+        for(int i = 0; i < n; i++) {
+            Conn& c = *static_cast<Conn*>(events[i].data.ptr);
+            uint32_t ev = events[i].events;
+            if(c.fd < 0) { continue; }
+            if(c.connecting) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if(err != 0 || (ev & (EPOLLERR | EPOLLHUP))) {
+                    stats_.connectErrors++;
+                    Close_(c, false);
+                    Backoff_(c);
+                    continue;
+                }
+                c.connecting = false;
+                Fill_(c, NowNs());
+            }
+            bool ok = true;
+            if(ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                bool open = Read_(c);
+                ok = Parse_(c) && open;
+            }
+            if(ok && (ev & EPOLLOUT)) {
+                ok = Flush_(c);
+            }
+            if(!ok) {
+                /* 对端关闭或 Connection: close：重新建立连接 */
+                Close_(c, true);
+                continue;
+            }
+            Fill_(c, NowNs());
+            if(!Flush_(c)) {
+                Close_(c, true);
+                continue;
+            }
+            UpdateEvents_(c);
+        }
+    }
+    for(auto& c : pool_) {
+        if(c.fd >= 0) {
+            close(c.fd);
+            c.fd = -1;
+        }
+    }
+    close(epollFd_);
+}
+
+/* 扫描目录，把其中的文件加入GET请求列表 */
+static void ScanResources(const string& root, const string& rel, vector<RequestTemplate>& out) {
+    DIR* dir = opendir((root + rel).c_str());
+    if(!dir) { return; }
+    struct dirent* ent;
+    while((ent = readdir(dir)) != nullptr) {
+        if(ent->d_name[0] == '.') { continue; }
+        string relPath = rel + "/" + ent->d_name;
+        struct stat st;
+        if(stat((root + relPath).c_str(), &st) != 0) { continue; }
+        if(S_ISDIR(st.st_mode)) {
+            ScanResources(root, relPath, out);
+        } else if(S_ISREG(st.st_mode)) {
+            out.push_back({"GET", relPath, "", false, "", ""});
+        }
+    }
+    closedir(dir);
+}
+
+static void Usage() {
+    fprintf(stderr,
+        "loadgen [options] http://host:port/path\n"
+        "  -c, --connections N   total connections (default 10)\n"
+        "  -t, --threads N       worker threads, each with its own epoll (default 1)\n"
+        "  -d, --duration S      test duration in seconds (default 10)\n"
+        "  -p, --pipeline N      max in-flight requests per connection (default 1)\n"
+        "  -r, --rate R          open-loop total rate in req/s; 0 = closed loop (default 0)\n"
+        "  -u, --url PATH        add a GET path to the mix (repeatable)\n"
+        "  -R, --resources DIR   add every file under DIR as a GET path\n"
+        "  -L, --login U:P       add a POST /login.html with the given credentials\n"
+        "  -G, --register P:W    add a POST /register.html with unique users prefixed by P\n"
+        "  -C, --close           send Connection: close (new connection per request)\n"
+        "  -j, --json FILE       write results as JSON to FILE ('-' for stdout)\n"
+        "  -h, --help            show this help\n");
+}
+
+static bool ParseUrl(const string& url, Options& opt, string& path) {
+    string rest = url;
+    if(rest.compare(0, 7, "http://") == 0) {
+        rest = rest.substr(7);
+    }
+    size_t slash = rest.find('/');
+    string hostPort = rest.substr(0, slash);
+    path = (slash == string::npos) ? "/" : rest.substr(slash);
+    size_t colon = hostPort.find(':');
+    if(colon != string::npos) {
+        opt.port = atoi(hostPort.c_str() + colon + 1);
+        hostPort = hostPort.substr(0, colon);
+    } else {
+        opt.port = 80;
+    }
+    opt.host = hostPort;
+    return !opt.host.empty() && opt.port > 0;
+}
+
+static void Report(const Options& opt, const Stats& total, const vector<uint64_t>& counts,
+                   uint64_t sum, double seconds) {
+    uint64_t p50 = Histogram::Percentile(counts, 0.50);
+    uint64_t p90 = Histogram::Percentile(counts, 0.90);
+    uint64_t p99 = Histogram::Percentile(counts, 0.99);
+    uint64_t p999 = Histogram::Percentile(counts, 0.999);
+    double mean = total.completed ? static_cast<double>(sum) / total.completed : 0;
+    double rps = seconds > 0 ? total.completed / seconds : 0;
+    uint64_t errors = total.connectErrors + total.readErrors + total.writeErrors + total.dropped;
+
+    printf("Running %ds test @ http://%s:%d (%s, %d connections, %d threads, pipeline %d)\n",
+           opt.duration, opt.host.c_str(), opt.port,
+           opt.rate > 0 ? "open loop" : "closed loop",
+           opt.connections, opt.threads, opt.pipeline);
+    if(opt.rate > 0) {
+        printf("  target rate: %.0f req/s\n", opt.rate);
+    }
+    printf("  requests: %llu in %.2fs, %.1f req/s, %.2f MB/s in\n",
+           (unsigned long long)total.completed, seconds, rps,
+           seconds > 0 ? total.bytesIn / seconds / (1 << 20) : 0);
+    printf("  status: 2xx=%llu 3xx=%llu 4xx=%llu other=%llu\n",
+           (unsigned long long)total.status2xx, (unsigned long long)total.status3xx,
+           (unsigned long long)total.status4xx, (unsigned long long)total.status5xx);
+    printf("  errors: connect=%llu read=%llu write=%llu dropped=%llu reconnects=%llu\n",
+           (unsigned long long)total.connectErrors, (unsigned long long)total.readErrors,
+           (unsigned long long)total.writeErrors, (unsigned long long)total.dropped,
+           (unsigned long long)total.reconnects);
+    printf("  latency(us): mean=%.1f p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu\n",
+           mean, (unsigned long long)p50, (unsigned long long)p90,
+           (unsigned long long)p99, (unsigned long long)p999,
+           (unsigned long long)total.maxLatencyUs);
+
+    if(opt.jsonFile.empty()) {
+        return;
+    }
+    FILE* fp = (opt.jsonFile == "-") ? stdout : fopen(opt.jsonFile.c_str(), "w");
+    if(!fp) {
+        perror("open json file");
+        return;
+    }
+    fprintf(fp,
+        "{\"target\":\"%s:%d\",\"mode\":\"%s\",\"rate\":%.1f,\"connections\":%d,"
+        "\"threads\":%d,\"pipeline\":%d,\"keep_alive\":%s,\"duration_s\":%.3f,"
+        "\"requests\":%llu,\"rps\":%.1f,\"bytes_in\":%llu,\"bytes_out\":%llu,"
+        "\"status\":{\"2xx\":%llu,\"3xx\":%llu,\"4xx\":%llu,\"other\":%llu},"
+        "\"errors\":{\"connect\":%llu,\"read\":%llu,\"write\":%llu,\"dropped\":%llu,\"total\":%llu},"
+        "\"latency_us\":{\"mean\":%.1f,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,"
+        "\"p999\":%llu,\"max\":%llu}}\n",
+        opt.host.c_str(), opt.port, opt.rate > 0 ? "open" : "closed", opt.rate,
+        opt.connections, opt.threads, opt.pipeline, opt.keepAlive ? "true" : "false", seconds,
+        (unsigned long long)total.completed, rps,
+        (unsigned long long)total.bytesIn, (unsigned long long)total.bytesOut,
+        (unsigned long long)total.status2xx, (unsigned long long)total.status3xx,
+        (unsigned long long)total.status4xx, (unsigned long long)total.status5xx,
+        (unsigned long long)total.connectErrors, (unsigned long long)total.readErrors,
+        (unsigned long long)total.writeErrors, (unsigned long long)total.dropped,
+        (unsigned long long)errors,
+        mean, (unsigned long long)p50, (unsigned long long)p90, (unsigned long long)p99,
+        (unsigned long long)p999, (unsigned long long)total.maxLatencyUs);
+    if(fp != stdout) {
+        fclose(fp);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    static const struct option longOptions[] = {
+        {"connections", required_argument, nullptr, 'c'},
+        {"threads",     required_argument, nullptr, 't'},
+        {"duration",    required_argument, nullptr, 'd'},
+        {"pipeline",    required_argument, nullptr, 'p'},
+        {"rate",        required_argument, nullptr, 'r'},
+        {"url",         required_argument, nullptr, 'u'},
+        {"resources",   required_argument, nullptr, 'R'},
+        {"login",       required_argument, nullptr, 'L'},
+        {"register",    required_argument, nullptr, 'G'},
+        {"close",       no_argument,       nullptr, 'C'},
+        {"json",        required_argument, nullptr, 'j'},
+        {"help",        no_argument,       nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    Options opt;
+    int ch;
+    while((ch = getopt_long(argc, argv, "c:t:d:p:r:u:R:L:G:Cj:h", longOptions, nullptr)) != -1) {
+        switch(ch) {
+        case 'c': opt.connections = atoi(optarg); break;
+        case 't': opt.threads = atoi(optarg); break;
+        case 'd': opt.duration = atoi(optarg); break;
+        case 'p': opt.pipeline = atoi(optarg); break;
+        case 'r': opt.rate = atof(optarg); break;
+        case 'u': opt.requests.push_back({"GET", optarg, "", false, "", ""}); break;
+        case 'R': ScanResources(optarg, "", opt.requests); break;
+        case 'L': {
+            string arg = optarg;
+            size_t colon = arg.find(':');
+            string user = arg.substr(0, colon);
+            string pwd = colon == string::npos ? "" : arg.substr(colon + 1);
+            opt.requests.push_back({"POST", "/login.html",
+                                    "username=" + user + "&password=" + pwd, false, "", ""});
+            break;
+        }
+        case 'G': {
+            string arg = optarg;
+            size_t colon = arg.find(':');
+            string prefix = arg.substr(0, colon);
+            string pwd = colon == string::npos ? "1" : arg.substr(colon + 1);
+            opt.requests.push_back({"POST", "/register.html", "", true, prefix, pwd});
+            break;
+        }
+        case 'C': opt.keepAlive = false; break;
+        case 'j': opt.jsonFile = optarg; break;
+        case 'h':
+        default:
+            Usage();
+            return ch == 'h' ? 0 : 2;
+        }
+    }
+    if(optind >= argc) {
+        Usage();
+        return 2;
+    }
+    string urlPath;
+    if(!ParseUrl(argv[optind], opt, urlPath)) {
+        fprintf(stderr, "bad url: %s\n", argv[optind]);
+        return 2;
+    }
+    if(opt.requests.empty()) {
+        opt.requests.push_back({"GET", urlPath, "", false, "", ""});
+    }
+    if(opt.connections < 1 || opt.threads < 1 || opt.duration < 1 || opt.pipeline < 1) {
+        fprintf(stderr, "connections, threads, duration and pipeline must be positive\n");
+        return 2;
+    }
+    opt.threads = min(opt.threads, opt.connections);
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* res = nullptr;
+    if(getaddrinfo(opt.host.c_str(), nullptr, &hints, &res) != 0 || !res) {
+        fprintf(stderr, "cannot resolve %s\n", opt.host.c_str());
+        return 1;
+    }
+    addr.sin_addr = reinterpret_cast<sockaddr_in*>(res->ai_addr)->sin_addr;
+    freeaddrinfo(res);
+
+    signal(SIGINT, OnSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    vector<Worker*> workers;
+    for(int i = 0; i < opt.threads; i++) {
+        int conns = opt.connections / opt.threads + (i < opt.connections % opt.threads ? 1 : 0);
+        double rate = opt.rate * conns / opt.connections;
+        workers.push_back(new Worker(opt, addr, conns, rate, i));
+    }
+    uint64_t start = NowNs();
+    uint64_t end = start + static_cast<uint64_t>(opt.duration) * 1000000000ULL;
+    vector<thread> threads;
+    for(auto w : workers) {
+        threads.emplace_back([w, end]() { w->Run(end); });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+    double seconds = (NowNs() - start) / 1e9;
+
+    Stats total;
+    vector<uint64_t> counts;
+    uint64_t sum = 0;
+    for(auto w : workers) {
+        const Stats& s = w->GetStats();
+        total.completed += s.completed;
+        total.status2xx += s.status2xx;
+        total.status3xx += s.status3xx;
+        total.status4xx += s.status4xx;
+        total.status5xx += s.status5xx;
+        total.connectErrors += s.connectErrors;
+        total.readErrors += s.readErrors;
+        total.writeErrors += s.writeErrors;
+        total.dropped += s.dropped;
+        total.reconnects += s.reconnects;
+        total.bytesIn += s.bytesIn;
+        total.bytesOut += s.bytesOut;
+        total.maxLatencyUs = max(total.maxLatencyUs, s.maxLatencyUs);
+        s.latency.MergeTo(counts, sum);
+        delete w;
+    }
+    Report(opt, total, counts, sum, seconds);
+    return total.completed > 0 ? 0 : 1;
+}